@@ -0,0 +1,555 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/**
+ * Microbenchmark of the containers for policies
+ *
+ *   Usage: ./bench [# of items] [# of picks]
+ *          ./bench -c [# of items] [# of operations]
+ *
+ * Each container starts with inserting the items with random keys. Then, it
+ * repeatedly picks the item with the least key, removes it, and inserts it
+ * back with a new key, as a scheduler does with the ready processes. At last,
+ * all the items are removed in a random order. The keys are KEY_BITS bits
+ * wide, and the bitmap priority index orders the items by the upper bits of
+ * their keys as it has only PRIO_INDEX_NR levels. The list_head is the
+ * baseline which the policies in pa2.c are built on; it appends items in O(1)
+ * and picks one by walking all the items.
+ *
+ * With -c, each container is checked instead against a reference scan over
+ * the items with random insertions, removals, and picks on keys with many
+ * ties, followed by picking all the items left. Every pick should take an
+ * item with the least key (level, for the bitmap priority index), and the
+ * containers keeping the insertion order should take the earliest inserted
+ * one among them.
+ */
+
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "heap.h"
+#include "dary_heap.h"
+#include "pairing_heap.h"
+#include "rbtree.h"
+#include "skiplist.h"
+#include "prio_index.h"
+
+struct item {
+	unsigned int key;
+	bool in;			/* In the container. For the check */
+	unsigned int seq;	/* When inserted. For the check */
+
+	struct list_head list;
+	struct heap_node heap;
+	struct dary_heap_node dary;
+	struct pairing_node pairing;
+	struct rb_node rb;
+	struct skiplist_node skip;
+	struct prio_index_node prio;
+};
+
+static struct item *items;
+static unsigned int nr_items;
+static unsigned int nr_picks;
+
+#define KEY_BITS	20
+
+static unsigned int __random_key(void)
+{
+	return rand() & ((1 << KEY_BITS) - 1);
+}
+
+
+/* list_head */
+static LIST_HEAD(list);
+
+static void list_init(void)
+{
+	INIT_LIST_HEAD(&list);
+}
+
+static void list_insert(struct item *item)
+{
+	list_add_tail(&item->list, &list);
+}
+
+static void list_remove(struct item *item)
+{
+	list_del_init(&item->list);
+}
+
+static bool list_is_empty(void)
+{
+	return list_empty(&list);
+}
+
+static struct item *list_pick(void)
+{
+	struct item *item, *least = NULL;
+
+	list_for_each_entry(item, &list, list) {
+		if (!least || item->key < least->key) least = item;
+	}
+	list_del_init(&least->list);
+	return least;
+}
+
+
+/* heap.h */
+static struct heap heap;
+
+static bool __heap_less(struct heap_node *a, struct heap_node *b)
+{
+	return heap_entry(a, struct item, heap)->key < heap_entry(b, struct item, heap)->key;
+}
+
+static void heap_init(void)
+{
+	INIT_HEAP(&heap, __heap_less);
+}
+
+static void heap_insert(struct item *item)
+{
+	heap_push(&heap, &item->heap);
+}
+
+static void heap_remove(struct item *item)
+{
+	heap_del(&heap, &item->heap);
+}
+
+static bool heap_is_empty(void)
+{
+	return heap_empty(&heap);
+}
+
+static struct item *heap_pick(void)
+{
+	return heap_entry(heap_pop(&heap), struct item, heap);
+}
+
+
+/* dary_heap.h */
+static struct dary_heap dary;
+
+static bool __dary_less(struct dary_heap_node *a, struct dary_heap_node *b)
+{
+	return dary_heap_entry(a, struct item, dary)->key <
+			dary_heap_entry(b, struct item, dary)->key;
+}
+
+static void dary_init(void)
+{
+	INIT_DARY_HEAP(&dary, 4, __dary_less);
+}
+
+static void dary_insert(struct item *item)
+{
+	dary_heap_push(&dary, &item->dary);
+}
+
+static void dary_remove(struct item *item)
+{
+	dary_heap_del(&dary, &item->dary);
+}
+
+static bool dary_is_empty(void)
+{
+	return dary_heap_empty(&dary);
+}
+
+static struct item *dary_pick(void)
+{
+	return dary_heap_entry(dary_heap_pop(&dary), struct item, dary);
+}
+
+
+/* pairing_heap.h */
+static struct pairing_heap pairing;
+
+static bool __pairing_less(struct pairing_node *a, struct pairing_node *b)
+{
+	return pairing_entry(a, struct item, pairing)->key <
+			pairing_entry(b, struct item, pairing)->key;
+}
+
+static void pairing_init(void)
+{
+	INIT_PAIRING_HEAP(&pairing, __pairing_less);
+}
+
+static void pairing_insert(struct item *item)
+{
+	pairing_push(&pairing, &item->pairing);
+}
+
+static void pairing_remove(struct item *item)
+{
+	pairing_del(&pairing, &item->pairing);
+}
+
+static bool pairing_is_empty(void)
+{
+	return pairing_empty(&pairing);
+}
+
+static struct item *pairing_pick(void)
+{
+	return pairing_entry(pairing_pop(&pairing), struct item, pairing);
+}
+
+
+/* rbtree.h */
+static struct rb_root rbtree;
+
+static bool __rb_less(struct rb_node *a, struct rb_node *b)
+{
+	return rb_entry(a, struct item, rb)->key < rb_entry(b, struct item, rb)->key;
+}
+
+static void rb_init(void)
+{
+	INIT_RB_ROOT(&rbtree, __rb_less);
+}
+
+static void rb_insert_item(struct item *item)
+{
+	rb_insert(&rbtree, &item->rb);
+}
+
+static void rb_remove(struct item *item)
+{
+	rb_del(&rbtree, &item->rb);
+}
+
+static bool rb_is_empty(void)
+{
+	return rb_empty(&rbtree);
+}
+
+static struct item *rb_pick(void)
+{
+	return rb_entry(rb_pop(&rbtree), struct item, rb);
+}
+
+
+/* skiplist.h */
+static struct skiplist skiplist;
+
+static bool __skip_less(struct skiplist_node *a, struct skiplist_node *b)
+{
+	return skiplist_entry(a, struct item, skip)->key <
+			skiplist_entry(b, struct item, skip)->key;
+}
+
+static void skip_init(void)
+{
+	INIT_SKIPLIST(&skiplist, __skip_less);
+}
+
+static void skip_insert(struct item *item)
+{
+	skiplist_insert(&skiplist, &item->skip);
+}
+
+static void skip_remove(struct item *item)
+{
+	skiplist_del(&skiplist, &item->skip);
+}
+
+static bool skip_is_empty(void)
+{
+	return skiplist_empty(&skiplist);
+}
+
+static struct item *skip_pick(void)
+{
+	return skiplist_entry(skiplist_pop(&skiplist), struct item, skip);
+}
+
+
+/* prio_index.h. The least key is the highest priority */
+static struct prio_index prio;
+
+static void prio_init(void)
+{
+	INIT_PRIO_INDEX(&prio);
+}
+
+static unsigned int __prio_level(unsigned int key)
+{
+	return (unsigned long)key * PRIO_INDEX_NR >> KEY_BITS;
+}
+
+static void prio_insert(struct item *item)
+{
+	prio_index_add(&prio, &item->prio, PRIO_INDEX_NR - 1 - __prio_level(item->key));
+}
+
+static void prio_remove(struct item *item)
+{
+	prio_index_del(&prio, &item->prio);
+}
+
+static bool prio_is_empty(void)
+{
+	return prio_index_empty(&prio);
+}
+
+static struct item *prio_pick(void)
+{
+	return prio_index_entry(prio_index_pop(&prio), struct item, prio);
+}
+
+
+static struct container {
+	const char *name;
+	void (*init)(void);
+	void (*insert)(struct item *);
+	void (*remove)(struct item *);
+	struct item *(*pick)(void);
+	bool (*empty)(void);
+	bool stable;		/* Keeps the items with the same key in the insertion order */
+	bool by_level;		/* Orders the items by the levels of their keys */
+} containers[] = {
+	{ "list_head", list_init, list_insert, list_remove, list_pick, list_is_empty, true },
+	{ "heap", heap_init, heap_insert, heap_remove, heap_pick, heap_is_empty },
+	{ "dary_heap", dary_init, dary_insert, dary_remove, dary_pick, dary_is_empty },
+	{ "pairing_heap", pairing_init, pairing_insert, pairing_remove, pairing_pick,
+			pairing_is_empty },
+	{ "rbtree", rb_init, rb_insert_item, rb_remove, rb_pick, rb_is_empty, true },
+	{ "skiplist", skip_init, skip_insert, skip_remove, skip_pick, skip_is_empty, true },
+	{ "prio_index", prio_init, prio_insert, prio_remove, prio_pick, prio_is_empty,
+			true, true },
+};
+
+static double __elapsed_ns(struct timespec *from)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - from->tv_sec) * 1e9 + (now.tv_nsec - from->tv_nsec);
+}
+
+static void __run(struct container *c, unsigned int *order)
+{
+	struct timespec start;
+	double insert_ns, pick_ns, remove_ns;
+
+	srand(1);
+	c->init();
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < nr_items; i++) {
+		items[i].key = __random_key();
+		c->insert(items + i);
+	}
+	insert_ns = __elapsed_ns(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < nr_picks; i++) {
+		struct item *item = c->pick();
+		item->key = __random_key();
+		c->insert(item);
+	}
+	pick_ns = __elapsed_ns(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < nr_items; i++) {
+		c->remove(items + order[i]);
+	}
+	remove_ns = __elapsed_ns(&start);
+
+	printf("%-14s %10.1f %14.1f %10.1f\n", c->name,
+			insert_ns / nr_items, pick_ns / nr_picks, remove_ns / nr_items);
+}
+
+/**
+ * Check mode. Keys are drawn from a few values so that ties are common, and
+ * spread over the levels of the bitmap priority index
+ */
+static unsigned int __check_key(void)
+{
+	return (rand() % 64) << (KEY_BITS - 6);
+}
+
+static unsigned int __check_rank(struct container *c, struct item *item)
+{
+	return c->by_level ? __prio_level(item->key) : item->key;
+}
+
+/* Reference scan for the item to pick next */
+static struct item *__check_expect(struct container *c)
+{
+	struct item *least = NULL;
+
+	for (int i = 0; i < nr_items; i++) {
+		struct item *item = items + i;
+
+		if (!item->in) continue;
+		if (!least || __check_rank(c, item) < __check_rank(c, least) ||
+				(__check_rank(c, item) == __check_rank(c, least) &&
+				 item->seq < least->seq)) {
+			least = item;
+		}
+	}
+	return least;
+}
+
+static bool __check_pick(struct container *c, unsigned int nr_in, unsigned int op)
+{
+	struct item *expect = __check_expect(c);
+	struct item *item;
+
+	if (c->empty() != !nr_in) {
+		printf("%-14s FAILED at operation %d: %s while %d items are in\n", c->name,
+				op, c->empty() ? "empty" : "not empty", nr_in);
+		return false;
+	}
+	if (!expect) return true;
+
+	item = c->pick();
+	if (item < items || item >= items + nr_items || !item->in ||
+			__check_rank(c, item) != __check_rank(c, expect) ||
+			(c->stable && item != expect)) {
+		printf("%-14s FAILED at operation %d: picked item %ld instead of %ld\n", c->name,
+				op, (long)(item - items), (long)(expect - items));
+		return false;
+	}
+	item->in = false;
+	return true;
+}
+
+static bool __check(struct container *c)
+{
+	unsigned int seq = 0, nr_in = 0;
+
+	srand(3);
+	c->init();
+	for (int i = 0; i < nr_items; i++) {
+		items[i].in = false;
+	}
+
+	for (int op = 0; op < nr_picks; op++) {
+		struct item *item = items + rand() % nr_items;
+
+		switch (rand() % 3) {
+		case 0:		/* Insert the item, or remove it if it is in */
+			if (!item->in) {
+				item->key = __check_key();
+				item->seq = seq++;
+				item->in = true;
+				c->insert(item);
+				nr_in++;
+				break;
+			}
+			c->remove(item);
+			item->in = false;
+			nr_in--;
+			break;
+		case 1:		/* Insert the item if it is not in yet */
+			if (item->in) break;
+			item->key = __check_key();
+			item->seq = seq++;
+			item->in = true;
+			c->insert(item);
+			nr_in++;
+			break;
+		default:
+			if (!__check_pick(c, nr_in, op)) return false;
+			if (nr_in) nr_in--;
+			break;
+		}
+	}
+
+	/* Pick all the items left in order */
+	while (nr_in) {
+		if (!__check_pick(c, nr_in, nr_picks)) return false;
+		nr_in--;
+	}
+	if (!__check_pick(c, 0, nr_picks)) return false;
+
+	printf("%-14s ok\n", c->name);
+	return true;
+}
+
+int main(int argc, char * const argv[])
+{
+	unsigned int *order;
+	bool check = argc > 1 && !strcmp(argv[1], "-c");
+
+	if (check) {
+		argc--;
+		argv++;
+	}
+	nr_items = argc > 1 ? atoi(argv[1]) : 1000;
+	nr_picks = argc > 2 ? atoi(argv[2]) : 100000;
+
+	if (!nr_items) {
+		fprintf(stderr, "Usage: %s {-c} [# of items] [# of picks (operations)]\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (check) {
+		bool ok = true;
+
+		items = malloc(sizeof(*items) * nr_items);
+		memset(items, 0x00, sizeof(*items) * nr_items);
+
+		printf("%d items, %d operations\n", nr_items, nr_picks);
+		for (int i = 0; i < sizeof(containers) / sizeof(*containers); i++) {
+			ok &= __check(containers + i);
+		}
+		free(items);
+		return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	items = malloc(sizeof(*items) * nr_items);
+	order = malloc(sizeof(*order) * nr_items);
+
+	/* Fault in the items so that the first container does not pay for it */
+	memset(items, 0x00, sizeof(*items) * nr_items);
+
+	/* Remove the items in a random order */
+	srand(2);
+	for (int i = 0; i < nr_items; i++) {
+		order[i] = i;
+	}
+	for (int i = nr_items - 1; i > 0; i--) {
+		int j = rand() % (i + 1);
+		unsigned int tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+
+	printf("%d items, %d picks (ns per operation)\n", nr_items, nr_picks);
+	printf("%-14s %10s %14s %10s\n", "container", "insert", "pick+insert", "remove");
+	for (int i = 0; i < sizeof(containers) / sizeof(*containers); i++) {
+		__run(containers + i, order);
+	}
+
+	free(items);
+	free(order);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+struct process;
+
+/**
+ * Checkpoint and restore of the simulation. With -C @tick, the framework
+ * saves the state of the simulation into a file (-W, checkpoint.bin by
+ * default) at the beginning of @tick, and goes on. With -R @file, it loads
+ * the same process script as usual, restores the state from @file, and
+ * continues the simulation from there. The checkpoint is bound to the
+ * script and the scheduler it was taken with.
+ *
+ * The framework saves what it maintains; the processes, the ready queue,
+ * the processes to fork, the resources with their owners and waiters, the
+ * groups, the pending timers, and the schedules and programs of processes.
+ * Schedulers save their own state in checkpoint() and load it in restore()
+ * with the functions below. By the time restore() is called, the framework
+ * has restored its state and has called forked() for the processes forked
+ * before the checkpoint and not exited yet, so the scheduler can overwrite
+ * what forked() has set up.
+ *
+ * checkpoint_get*() abort the simulation if the checkpoint is truncated.
+ */
+void checkpoint_put(const void *data, size_t size);
+void checkpoint_get(void *data, size_t size);
+
+void checkpoint_put_uint(unsigned int value);
+unsigned int checkpoint_get_uint(void);
+
+/* @p can be NULL */
+void checkpoint_put_process(struct process *p);
+struct process *checkpoint_get_process(void);
+
+/**
+ * Call @fn for the processes forked and not exited yet in the same order
+ * whether checkpointing or restoring
+ */
+void checkpoint_for_each_process(void (*fn)(struct process *));
+
+#endif
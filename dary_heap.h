@@ -0,0 +1,186 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __DARY_HEAP_H__
+#define __DARY_HEAP_H__
+
+/*
+ * Intrusive d-ary heap, which generalizes the binary heap in heap.h.
+ *
+ * A node has up to @arity children that are next to each other in the array,
+ * so the heap is shallower and a sift-down compares the children in a cache
+ * line. Pushing and updating get cheaper while popping compares more nodes
+ * per level; 4 is a good arity for most cases. Embed struct dary_heap_node
+ * into the structure to keep in the heap, and get the structure back with
+ * dary_heap_entry(). Each node remembers its position in the heap as in
+ * heap.h.
+ *
+ * Include list_head.h (for container_of) and stdlib.h before this file.
+ */
+
+#define DARY_HEAP_NOT_QUEUED	(~0U)
+
+struct dary_heap_node {
+	unsigned int index;
+};
+
+struct dary_heap {
+	struct dary_heap_node **nodes;
+	unsigned int nr_nodes;
+	unsigned int size;
+	unsigned int arity;
+	bool (*less)(struct dary_heap_node *, struct dary_heap_node *);
+};
+
+#define dary_heap_entry(ptr, type, member) \
+	container_of(ptr, type, member)
+
+static inline void INIT_DARY_HEAP(struct dary_heap *heap, unsigned int arity,
+		bool (*less)(struct dary_heap_node *, struct dary_heap_node *))
+{
+	heap->nodes = NULL;
+	heap->nr_nodes = 0;
+	heap->size = 0;
+	heap->arity = arity;
+	heap->less = less;
+}
+
+static inline void INIT_DARY_HEAP_NODE(struct dary_heap_node *node)
+{
+	node->index = DARY_HEAP_NOT_QUEUED;
+}
+
+static inline bool dary_heap_empty(const struct dary_heap *heap)
+{
+	return heap->nr_nodes == 0;
+}
+
+static inline bool dary_heap_queued(const struct dary_heap_node *node)
+{
+	return node->index != DARY_HEAP_NOT_QUEUED;
+}
+
+/**
+ * dary_heap_top - get the least node in the heap, or NULL if the heap is empty
+ */
+static inline struct dary_heap_node *dary_heap_top(const struct dary_heap *heap)
+{
+	return heap->nr_nodes ? heap->nodes[0] : NULL;
+}
+
+static inline void __dary_heap_set(struct dary_heap *heap, unsigned int index,
+		struct dary_heap_node *node)
+{
+	heap->nodes[index] = node;
+	node->index = index;
+}
+
+static inline void __dary_heap_sift_up(struct dary_heap *heap, unsigned int index)
+{
+	struct dary_heap_node *node = heap->nodes[index];
+
+	while (index > 0) {
+		unsigned int parent = (index - 1) / heap->arity;
+		if (!heap->less(node, heap->nodes[parent])) break;
+
+		__dary_heap_set(heap, index, heap->nodes[parent]);
+		index = parent;
+	}
+	__dary_heap_set(heap, index, node);
+}
+
+static inline void __dary_heap_sift_down(struct dary_heap *heap, unsigned int index)
+{
+	struct dary_heap_node *node = heap->nodes[index];
+
+	while (true) {
+		unsigned int first = index * heap->arity + 1;
+		unsigned int last = first + heap->arity;
+		unsigned int child = first;
+
+		if (first >= heap->nr_nodes) break;
+		if (last > heap->nr_nodes) last = heap->nr_nodes;
+
+		for (unsigned int i = first + 1; i < last; i++) {
+			if (heap->less(heap->nodes[i], heap->nodes[child])) child = i;
+		}
+		if (!heap->less(heap->nodes[child], node)) break;
+
+		__dary_heap_set(heap, index, heap->nodes[child]);
+		index = child;
+	}
+	__dary_heap_set(heap, index, node);
+}
+
+/**
+ * dary_heap_push - add a new node into the heap
+ */
+static inline void dary_heap_push(struct dary_heap *heap, struct dary_heap_node *node)
+{
+	if (heap->nr_nodes == heap->size) {
+		heap->size = heap->size ? heap->size * 2 : 8;
+		heap->nodes = realloc(heap->nodes, sizeof(*heap->nodes) * heap->size);
+	}
+
+	heap->nodes[heap->nr_nodes] = node;
+	__dary_heap_sift_up(heap, heap->nr_nodes++);
+}
+
+/**
+ * dary_heap_update - re-position @node after its key is changed
+ */
+static inline void dary_heap_update(struct dary_heap *heap, struct dary_heap_node *node)
+{
+	__dary_heap_sift_up(heap, node->index);
+	__dary_heap_sift_down(heap, node->index);
+}
+
+/**
+ * dary_heap_del - remove @node from the heap
+ */
+static inline void dary_heap_del(struct dary_heap *heap, struct dary_heap_node *node)
+{
+	unsigned int index = node->index;
+	struct dary_heap_node *last = heap->nodes[--heap->nr_nodes];
+
+	INIT_DARY_HEAP_NODE(node);
+	if (last == node) return;
+
+	__dary_heap_set(heap, index, last);
+	dary_heap_update(heap, last);
+}
+
+/**
+ * dary_heap_pop - remove the least node from the heap and return it
+ */
+static inline struct dary_heap_node *dary_heap_pop(struct dary_heap *heap)
+{
+	struct dary_heap_node *top = dary_heap_top(heap);
+
+	if (top) dary_heap_del(heap, top);
+	return top;
+}
+
+/**
+ * dary_heap_destroy - free the array of the heap. The heap should be empty
+ */
+static inline void dary_heap_destroy(struct dary_heap *heap)
+{
+	free(heap->nodes);
+	heap->nodes = NULL;
+	heap->size = 0;
+}
+
+#endif
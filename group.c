@@ -0,0 +1,206 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "heap.h"
+
+#include "process.h"
+#include "group.h"
+
+extern struct list_head readyqueue;
+extern unsigned int ticks;
+
+LIST_HEAD(groups);
+unsigned int nr_parked_processes = 0;
+
+static void __unthrottle(struct group *g)
+{
+	struct process *p, *tmp;
+	unsigned int period_end = g->period_start + g->period;
+
+	g->throttled = false;
+	g->throttled_ticks += period_end - g->throttled_at;
+
+	g->usage = 0;
+	g->period_start = period_end;
+
+	/* Put the parked processes back to the ready queue in the parking order */
+	list_for_each_entry_safe(p, tmp, &g->parked, list) {
+		assert(p->status == PROCESS_THROTTLED);
+		p->status = PROCESS_READY;
+		list_move_tail(&p->list, &readyqueue);
+		nr_parked_processes--;
+	}
+}
+
+static void __unthrottle_group(struct timer *timer)
+{
+	__unthrottle(container_of(timer, struct group, timer));
+}
+
+struct group *get_group(const char *name)
+{
+	struct group *g;
+	struct group *parent = NULL;
+	char *sep;
+
+	list_for_each_entry(g, &groups, list) {
+		if (strcmp(g->name, name) == 0) return g;
+	}
+
+	/* Get the parent group, which is named with the path up to the last '/' */
+	sep = strrchr(name, '/');
+	if (sep) {
+		char *parent_name = malloc(sep - name + 1);
+
+		strncpy(parent_name, name, sep - name);
+		parent_name[sep - name] = '\0';
+		parent = get_group(parent_name);
+		free(parent_name);
+	}
+
+	g = malloc(sizeof(*g));
+	memset(g, 0x00, sizeof(*g));
+
+	g->name = malloc(strlen(name) + 1);
+	strcpy(g->name, name);
+	g->parent = parent;
+	g->weight = GROUP_DEFAULT_WEIGHT;
+	INIT_LIST_HEAD(&g->parked);
+	init_timer(&g->timer, __unthrottle_group);
+
+	list_add_tail(&g->list, &groups);
+
+	return g;
+}
+
+/* Return true if @g is @ancestor or one of its descendants */
+static bool __group_within(struct group *g, struct group *ancestor)
+{
+	for (; g; g = g->parent) {
+		if (g == ancestor) return true;
+	}
+	return false;
+}
+
+/* Charge a tick to @g. Throttle @g and return true if it runs out of the quota */
+static bool __charge(struct group *g)
+{
+	struct process *q, *tmp;
+
+	g->nr_ticks++;
+
+	if (!g->quota) return false;
+
+	/**
+	 * Periods are aligned to tick 0. Start a new period if the group has not
+	 * run for a while
+	 */
+	if (ticks >= g->period_start + g->period) {
+		g->period_start = ticks - (ticks % g->period);
+		g->usage = 0;
+	}
+
+	if (++g->usage < g->quota) return false;
+
+	/* Ran out of the quota. Park the processes in the subtree until the next period */
+	g->throttled = true;
+	g->throttled_at = ticks + 1;
+	g->nr_throttled++;
+
+	list_for_each_entry_safe(q, tmp, &readyqueue, list) {
+		if (__group_within(q->group, g)) park_process(q);
+	}
+
+	return true;
+}
+
+bool charge_group(struct process *p)
+{
+	bool throttled = false;
+
+	for (struct group *g = p->group; g; g = g->parent) {
+		throttled |= __charge(g);
+	}
+
+	return throttled;
+}
+
+/**
+ * Find the group which keeps @p from running; @p's group or one of its
+ * ancestors being throttled. NULL if there is none
+ */
+static struct group *__throttled_group(struct process *p)
+{
+	for (struct group *g = p->group; g; g = g->parent) {
+		if (!g->throttled) continue;
+
+		/**
+		 * The unthrottling timer is armed only when a process is parked. Without
+		 * one, the throttling may be over already
+		 */
+		if (ticks >= g->period_start + g->period) {
+			__unthrottle(g);
+			continue;
+		}
+		return g;
+	}
+	return NULL;
+}
+
+bool process_throttled(struct process *p)
+{
+	return __throttled_group(p) != NULL;
+}
+
+void park_process(struct process *p)
+{
+	/* __throttled_group() may unthrottle groups. Call it in any build */
+	struct group *g = __throttled_group(p);
+
+	assert(g);
+
+	p->status = PROCESS_THROTTLED;
+	list_del_init(&p->list);
+	list_add_tail(&p->list, &g->parked);
+	nr_parked_processes++;
+
+	/* Unthrottle the group at the beginning of the next period */
+	if (!timer_pending(&g->timer)) {
+		add_timer(&g->timer, g->period_start + g->period);
+	}
+}
+
+void report_groups(void)
+{
+	struct group *g;
+
+	list_for_each_entry(g, &groups, list) {
+		printf("- Group %s: ran %d ticks", g->name, g->nr_ticks);
+		if (g->quota) {
+			printf(" under quota %d/%d, throttled %d time%s for %d ticks",
+					g->quota, g->period,
+					g->nr_throttled, g->nr_throttled >= 2 ? "s" : "",
+					g->throttled_ticks);
+		}
+		printf("\n");
+	}
+}
@@ -0,0 +1,105 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __GROUP_H__
+#define __GROUP_H__
+
+#include "timer.h"
+
+struct process;
+
+/**
+ * Process group. Processes join a group with the @group property, and the
+ * groups form a hierarchy by their names; group "acme/web" is a child of
+ * group "acme". Each group has a @weight to share the processor with its
+ * siblings (see the hierarchical fair-share scheduler in pa2.c).
+ *
+ * A group may also be given a CPU bandwidth quota with the @quota directive. The
+ * processes in the group can run @quota ticks in total in every @period ticks.
+ * When the group runs out of the quota, it is throttled; the processes in the
+ * group and its descendants are parked on @parked off the ready queue until
+ * the next period begins. A tick is charged to all the ancestors of the
+ * group as well, so the quota of a group bounds its whole subtree.
+ */
+struct group {
+	char *name;				/* Name of the group */
+	struct group *parent;	/* Parent group. NULL for top-level groups */
+	unsigned int weight;	/* Weight among the sibling groups */
+
+	unsigned int quota;		/* Ticks allowed in a period. 0 for no limit */
+	unsigned int period;	/* Length of the bandwidth period */
+
+	unsigned int usage;		/* Ticks consumed in the current period */
+	unsigned int period_start;
+							/* Tick when the current period started */
+
+	bool throttled;			/* True if the group is throttled */
+	struct list_head parked;
+							/* Processes parked while throttled */
+	struct timer timer;		/* Timer to unthrottle the group */
+
+	/* Statistics */
+	unsigned int nr_ticks;	/* # of ticks consumed */
+	unsigned int nr_throttled;
+							/* # of periods being throttled */
+	unsigned int throttled_ticks;
+							/* # of ticks being throttled */
+	unsigned int throttled_at;
+
+	void *private;			/* Scheduler-private data */
+
+	struct list_head list;	/* list head for listing groups */
+};
+
+#define GROUP_DEFAULT_WEIGHT	1024
+
+/**
+ * All groups in the system. Parents are listed before their children
+ */
+extern struct list_head groups;
+
+/**
+ * # of processes parked in the throttled groups
+ */
+extern unsigned int nr_parked_processes;
+
+/**
+ * Find the group named @name. Create a new one if it does not exist, along
+ * with its ancestor groups
+ */
+struct group *get_group(const char *name);
+
+/**
+ * Charge a tick consumed by @p to its group and the ancestors. Throttle those
+ * running out of the quota, and return true in that case
+ */
+bool charge_group(struct process *p);
+
+/**
+ * Return true if @p should not run as its group or an ancestor is throttled
+ */
+bool process_throttled(struct process *p);
+
+/**
+ * Park @p until its group is unthrottled
+ */
+void park_process(struct process *p);
+
+/**
+ * Print the bandwidth statistics of the groups
+ */
+void report_groups(void);
+
+#endif
@@ -0,0 +1,174 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __HEAP_H__
+#define __HEAP_H__
+
+/*
+ * Intrusive binary heap in the same flavor as list_head.h.
+ *
+ * Embed struct heap_node into the structure to keep in the heap, and get the
+ * structure back with heap_entry(). The heap is ordered by @less() so that
+ * heap_top() returns the node which is less than any other node in the heap.
+ * Each node remembers its position in the heap, so a node can be removed or
+ * re-positioned after changing its key in O(log n).
+ *
+ * Include list_head.h (for container_of) and stdlib.h before this file.
+ */
+
+#define HEAP_NOT_QUEUED	(~0U)
+
+struct heap_node {
+	unsigned int index;
+};
+
+struct heap {
+	struct heap_node **nodes;
+	unsigned int nr_nodes;
+	unsigned int size;
+	bool (*less)(struct heap_node *, struct heap_node *);
+};
+
+#define heap_entry(ptr, type, member) \
+	container_of(ptr, type, member)
+
+static inline void INIT_HEAP(struct heap *heap,
+		bool (*less)(struct heap_node *, struct heap_node *))
+{
+	heap->nodes = NULL;
+	heap->nr_nodes = 0;
+	heap->size = 0;
+	heap->less = less;
+}
+
+static inline void INIT_HEAP_NODE(struct heap_node *node)
+{
+	node->index = HEAP_NOT_QUEUED;
+}
+
+static inline bool heap_empty(const struct heap *heap)
+{
+	return heap->nr_nodes == 0;
+}
+
+static inline bool heap_queued(const struct heap_node *node)
+{
+	return node->index != HEAP_NOT_QUEUED;
+}
+
+/**
+ * heap_top - get the least node in the heap, or NULL if the heap is empty
+ */
+static inline struct heap_node *heap_top(const struct heap *heap)
+{
+	return heap->nr_nodes ? heap->nodes[0] : NULL;
+}
+
+#define heap_top_entry_or_null(heap, type, member) ({ \
+	struct heap_node *__top = heap_top(heap); \
+	__top ? heap_entry(__top, type, member) : NULL; \
+})
+
+static inline void __heap_set(struct heap *heap, unsigned int index,
+		struct heap_node *node)
+{
+	heap->nodes[index] = node;
+	node->index = index;
+}
+
+static inline void __heap_sift_up(struct heap *heap, unsigned int index)
+{
+	struct heap_node *node = heap->nodes[index];
+
+	while (index > 0) {
+		unsigned int parent = (index - 1) / 2;
+		if (!heap->less(node, heap->nodes[parent])) break;
+
+		__heap_set(heap, index, heap->nodes[parent]);
+		index = parent;
+	}
+	__heap_set(heap, index, node);
+}
+
+static inline void __heap_sift_down(struct heap *heap, unsigned int index)
+{
+	struct heap_node *node = heap->nodes[index];
+
+	while (true) {
+		unsigned int child = index * 2 + 1;
+		if (child >= heap->nr_nodes) break;
+
+		if (child + 1 < heap->nr_nodes &&
+				heap->less(heap->nodes[child + 1], heap->nodes[child])) {
+			child++;
+		}
+		if (!heap->less(heap->nodes[child], node)) break;
+
+		__heap_set(heap, index, heap->nodes[child]);
+		index = child;
+	}
+	__heap_set(heap, index, node);
+}
+
+/**
+ * heap_push - add a new node into the heap
+ */
+static inline void heap_push(struct heap *heap, struct heap_node *node)
+{
+	if (heap->nr_nodes == heap->size) {
+		heap->size = heap->size ? heap->size * 2 : 8;
+		heap->nodes = realloc(heap->nodes, sizeof(*heap->nodes) * heap->size);
+	}
+
+	heap->nodes[heap->nr_nodes] = node;
+	__heap_sift_up(heap, heap->nr_nodes++);
+}
+
+/**
+ * heap_update - re-position @node after its key is changed
+ */
+static inline void heap_update(struct heap *heap, struct heap_node *node)
+{
+	__heap_sift_up(heap, node->index);
+	__heap_sift_down(heap, node->index);
+}
+
+/**
+ * heap_del - remove @node from the heap
+ */
+static inline void heap_del(struct heap *heap, struct heap_node *node)
+{
+	unsigned int index = node->index;
+	struct heap_node *last = heap->nodes[--heap->nr_nodes];
+
+	INIT_HEAP_NODE(node);
+	if (last == node) return;
+
+	__heap_set(heap, index, last);
+	heap_update(heap, last);
+}
+
+/**
+ * heap_pop - remove the least node from the heap and return it
+ */
+static inline struct heap_node *heap_pop(struct heap *heap)
+{
+	struct heap_node *top = heap_top(heap);
+
+	if (top) heap_del(heap, top);
+	return top;
+}
+
+#endif
@@ -0,0 +1,123 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/* clock_gettime() */
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <time.h>
+
+#include "instrument.h"
+
+#ifdef CONFIG_INSTRUMENT
+
+#if defined(__x86_64__) || defined(__i386__)
+#define INSTRUMENT_UNIT	"cycles"
+#else
+#define INSTRUMENT_UNIT	"ns"
+#endif
+
+/**
+ * Bucket 0 counts the calls that cost 0, and bucket n counts the calls that
+ * cost [2^(n-1), 2^n). The last bucket takes all the more expensive calls
+ */
+#define NR_INSTRUMENT_BUCKETS	32
+
+struct instrument_stat {
+	unsigned long long nr_calls;
+	unsigned long long total;
+	unsigned long long max;
+	unsigned long long buckets[NR_INSTRUMENT_BUCKETS];
+};
+
+static struct instrument_stat __stats[NR_INSTRUMENT_CALLBACKS];
+
+static const char * const __callback_name[NR_INSTRUMENT_CALLBACKS] = {
+	"schedule",
+	"acquire",
+	"release",
+	"cancel",
+	"forked",
+	"exiting",
+};
+
+/* When the simulation started, to convert the cost into ns */
+static unsigned long long __started_at;
+static unsigned long long __started_at_ns;
+
+static unsigned long long __clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#if !defined(__x86_64__) && !defined(__i386__)
+unsigned long long instrument_clock(void)
+{
+	return __clock_ns();
+}
+#endif
+
+void instrument_account(enum instrument_callback callback, unsigned long long cost)
+{
+	struct instrument_stat *stat = __stats + callback;
+	unsigned int bucket = cost ? 64 - __builtin_clzll(cost) : 0;
+
+	if (bucket >= NR_INSTRUMENT_BUCKETS) bucket = NR_INSTRUMENT_BUCKETS - 1;
+
+	stat->nr_calls++;
+	stat->total += cost;
+	if (cost > stat->max) stat->max = cost;
+	stat->buckets[bucket]++;
+}
+
+void instrument_start(void)
+{
+	__started_at = instrument_now();
+	__started_at_ns = __clock_ns();
+}
+
+void instrument_report(void)
+{
+	unsigned long long elapsed = instrument_now() - __started_at;
+	double ns_per_unit = elapsed ?
+			(double)(__clock_ns() - __started_at_ns) / elapsed : 1.0;
+
+	for (int i = 0; i < NR_INSTRUMENT_CALLBACKS; i++) {
+		struct instrument_stat *stat = __stats + i;
+
+		if (!stat->nr_calls) continue;
+
+		printf("- Callback %s: %llu call%s, %llu " INSTRUMENT_UNIT " (%.0f ns) in total, "
+				"%.1f " INSTRUMENT_UNIT " on average, %llu " INSTRUMENT_UNIT " at most\n",
+				__callback_name[i], stat->nr_calls, stat->nr_calls >= 2 ? "s" : "",
+				stat->total, stat->total * ns_per_unit,
+				(double)stat->total / stat->nr_calls, stat->max);
+
+		for (int j = 0; j < NR_INSTRUMENT_BUCKETS; j++) {
+			if (!stat->buckets[j]) continue;
+
+			if (j == NR_INSTRUMENT_BUCKETS - 1) {
+				printf("    >= %llu " INSTRUMENT_UNIT ": %llu\n", 1ULL << (j - 1), stat->buckets[j]);
+			} else {
+				printf("    < %llu " INSTRUMENT_UNIT ": %llu\n", 1ULL << j, stat->buckets[j]);
+			}
+		}
+	}
+}
+#endif
@@ -0,0 +1,78 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __INSTRUMENT_H__
+#define __INSTRUMENT_H__
+
+/**
+ * Instrumentation of the scheduler callbacks. Built with CONFIG_INSTRUMENT
+ * (make INSTRUMENT=1), the framework times every call to the callbacks and
+ * reports the number of calls, the total cost, and the histogram of the cost
+ * of each callback at the end of the simulation. The cost is measured with
+ * the time stamp counter on x86 and clock_gettime() elsewhere. Without
+ * CONFIG_INSTRUMENT, instrument() just makes the call.
+ */
+enum instrument_callback {
+	INSTRUMENT_SCHEDULE,
+	INSTRUMENT_ACQUIRE,
+	INSTRUMENT_RELEASE,
+	INSTRUMENT_CANCEL,
+	INSTRUMENT_FORKED,
+	INSTRUMENT_EXITING,
+	NR_INSTRUMENT_CALLBACKS,
+};
+
+#ifdef CONFIG_INSTRUMENT
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+static inline unsigned long long instrument_now(void)
+{
+	return __rdtsc();
+}
+#else
+unsigned long long instrument_clock(void);
+
+static inline unsigned long long instrument_now(void)
+{
+	return instrument_clock();
+}
+#endif
+
+void instrument_account(enum instrument_callback callback, unsigned long long cost);
+void instrument_start(void);
+void instrument_report(void);
+
+#define instrument(callback, call) do { \
+	unsigned long long __instrument_start = instrument_now(); \
+	call; \
+	instrument_account(callback, instrument_now() - __instrument_start); \
+} while (0)
+
+#else
+#define instrument(callback, call) do { \
+	call; \
+} while (0)
+
+static inline void instrument_start(void)
+{
+}
+
+static inline void instrument_report(void)
+{
+}
+#endif
+
+#endif
@@ -17,10 +17,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "types.h"
 #include "list_head.h"
+#include "heap.h"
+#include "readyset.h"
+#include "schedstat.h"
+#include "checkpoint.h"
 
 /**
  * The process which is currently running
@@ -38,7 +43,12 @@ extern struct list_head readyqueue;
  * Resources in the system.
  */
 #include "resource.h"
-extern struct resource resources[NR_RESOURCES];
+
+
+/**
+ * Process groups in the system. See group.h
+ */
+#include "group.h"
 
 
 /**
@@ -66,13 +76,12 @@ bool fcfs_acquire(int resource_id)
 {
 	struct resource *r = resources + resource_id;
 
-	if (!r->owner) {
-		/* This resource is not owned by any one. Take it! */
-		r->owner = current;
+	if (resource_take(r, current)) {
+		/* This resource is available. Took it! */
 		return true;
 	}
 
-	/* OK, this resource is taken by @r->owner. */
+	/* OK, this resource is taken by others. */
 
 	/* Update the current process state */
 	current->status = PROCESS_WAIT;
@@ -88,6 +97,18 @@ bool fcfs_acquire(int resource_id)
 	return false;
 }
 
+/***********************************************************************
+ * Default FCFS resource cancel function
+ *
+ * DESCRIPTION
+ *   Take @p, which gives up acquiring resource @resource_id, out of the
+ *   waitqueue. The framework will put it back into the ready queue.
+ ***********************************************************************/
+void fcfs_cancel(int resource_id, struct process *p)
+{
+	list_del_init(&p->list);
+}
+
 /***********************************************************************
  * Default FCFS resource release function
  *
@@ -101,17 +122,22 @@ void fcfs_release(int resource_id)
 {
 	struct resource *r = resources + resource_id;
 
-	/* Ensure that the owner process is releasing the resource */
-	assert(r->owner == current);
+	unsigned int woken = 0;
 
-	/* Un-own this resource */
-	r->owner = NULL;
+	/* Un-own this resource. It also ensures that the holder is releasing it */
+	resource_put(r, current);
 
-	/* Let's wake up ONE waiter (if exists) that came first */
-	if (!list_empty(&r->waitqueue)) {
+	/**
+	 * Let's wake up the waiters that came first as long as they can take the
+	 * resource. It is ONE waiter for exclusive resources whereas many waiters
+	 * may share the resource
+	 */
+	while (!list_empty(&r->waitqueue)) {
 		struct process *waiter =
 				list_first_entry(&r->waitqueue, struct process, list);
 
+		if (!resource_wakeable(r, waiter, &woken)) break;
+
 		/**
 		 * Ensure the waiter  is in the wait status
 		 */
@@ -165,10 +191,11 @@ static struct process *fifo_schedule(void)
 	 * no @current process. In this case, pick the next without examining
 	 * the current process. Also, when the current process is blocked
 	 * while acquiring a resource, @current is (supposed to be) attached
-	 * to the waitqueue of the corresponding resource. In this case just
-	 * pick the next as well.
+	 * to the waitqueue of the corresponding resource. Similarly, @current
+	 * is parked off the ready queue when its group is throttled. In these
+	 * cases just pick the next as well.
 	 */
-	if (!current || current->status == PROCESS_WAIT) {
+	if (!current || current->status != PROCESS_RUNNING) {
 		goto pick_next;
 	}
 
@@ -186,6 +213,7 @@ pick_next:
 		 * in the ready queue
 		 */
 		next = list_first_entry(&readyqueue, struct process, list);
+		schedstat_visit(1);
 
 		/**
 		 * Detach the process from the ready queue. Note we use list_del_init()
@@ -200,10 +228,11 @@ pick_next:
 }
 
 
-struct scheduler fifo_scheduler = {
+const struct scheduler fifo_scheduler = {
 	.name = "FIFO",
 	.acquire = fcfs_acquire,
 	.release = fcfs_release,
+	.cancel = fcfs_cancel,
 	.initialize = fifo_initialize,
 	.finalize = fifo_finalize,
 	.schedule = fifo_schedule,
@@ -211,57 +240,109 @@ struct scheduler fifo_scheduler = {
 
 
 /***********************************************************************
- * SJF scheduler
+ * Ready set for SJF, SRTF, and priority schedulers
+ *
+ * DESCRIPTION
+ *   These schedulers pick the process with the smallest (largest) key among
+ *   all the ready processes. They take the processes that became ready out
+ *   of @readyqueue into @ready, which keeps the keys in an array, so that
+ *   the pick is made with a vectorized scan over the keys. The key of a
+ *   process does not change while it is ready. See readyset.h
  ***********************************************************************/
-static struct process *sjf_schedule(void)
+static struct ready_set ready = READY_SET_INIT;
+
+static unsigned int __ready_lifespan(struct process *p)
 {
-    struct process *next = NULL;
-    struct process *pnext = NULL;
-    struct process *endp = NULL;
-    int min = 100;
+	return p->lifespan;
+}
 
-   //현재 상태가 wait일때
-    if(!current || current->status == PROCESS_WAIT){
-        goto pick_next;
-    }//next 결정해서 뽑기
+static unsigned int __ready_remaining(struct process *p)
+{
+	return p->lifespan - p->age;
+}
 
-    if(current->age < current->lifespan){
-        return current;}
+static unsigned int __ready_prio(struct process *p)
+{
+	return p->prio;
+}
 
-pick_next:
-    
-if(!list_empty(&readyqueue)){
-    pnext = list_first_entry(&readyqueue, struct process, list);
-    endp = list_last_entry(&readyqueue, struct process, list);
-    printf("endp->pid : %d\n", endp->pid);
-    next = pnext;
-   // max = pnext->prio;
-   // next = pnext;
-   // pnext = list_next_entry(pnext, list);
+/* Take the processes on @readyqueue, which became ready since the last pick */
+static void __ready_fill(unsigned int (*key)(struct process *))
+{
+	struct process *p, *tmp;
 
-    while(pnext){
-       
-        if(min>pnext->lifespan){
-            min = pnext->lifespan;
-            next = pnext;
-        }
-        if(pnext->pid == endp->pid)
-            break;
-        pnext = list_next_entry(pnext, list);
-        //if(pnext->pid == 0)
-          //  break;
-    }
+	list_for_each_entry_safe(p, tmp, &readyqueue, list) {
+		list_del_init(&p->list);
+		ready_set_add(&ready, p, key(p));
+	}
+}
 
-    list_del_init(&next->list);
+static void ready_finalize(void)
+{
+	ready_set_destroy(&ready);
 }
-	return next;
 
+static void ready_for_each(void (*fn)(struct process *))
+{
+	for (int i = 0; i < ready.nr; i++) {
+		fn(ready.processes[i]);
+	}
+}
+
+static void ready_checkpoint(void)
+{
+	checkpoint_put_uint(ready.nr);
+	checkpoint_put_uint(ready.seq);
+	for (int i = 0; i < ready.nr; i++) {
+		checkpoint_put_process(ready.processes[i]);
+		checkpoint_put_uint(ready.keys[i]);
+		checkpoint_put_uint(ready.seqs[i]);
+	}
+}
+
+static void ready_restore(void)
+{
+	unsigned int nr = checkpoint_get_uint();
+	unsigned int seq = checkpoint_get_uint();
+
+	for (int i = 0; i < nr; i++) {
+		struct process *p = checkpoint_get_process();
+
+		ready_set_add(&ready, p, checkpoint_get_uint());
+		ready.seqs[i] = checkpoint_get_uint();
+	}
+	ready.seq = seq;
+}
+
+
+/***********************************************************************
+ * SJF scheduler
+ ***********************************************************************/
+static struct process *sjf_schedule(void)
+{
+	/* SJF is non-preemptive. Keep running the current until it completes */
+	if (current && current->status == PROCESS_RUNNING &&
+			current->age < current->lifespan) {
+		return current;
+	}
+
+	/* Take the processes that became ready into the ready set */
+	__ready_fill(__ready_lifespan);
+	if (!ready.nr) return NULL;
+
+	schedstat_visit(ready.nr);
+	return ready_set_del(&ready, ready_set_argmin(&ready));
 }
 
-struct scheduler sjf_scheduler = {
+const struct scheduler sjf_scheduler = {
 	.name = "Shortest-Job First",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
+	.cancel = fcfs_cancel, /* Use the default FCFS cancel() */
+	.finalize = ready_finalize,
+	.for_each_ready = ready_for_each,
+	.checkpoint = ready_checkpoint,
+	.restore = ready_restore,
 	.schedule = sjf_schedule,		 /* TODO: Assign sjf_schedule()
 								to this function pointer to activate
 								SJF in the system */
@@ -272,60 +353,30 @@ struct scheduler sjf_scheduler = {
  * SRTF scheduler
  ***********************************************************************/
 
-static struct process * srtf_schedule(void)
+static struct process *srtf_schedule(void)
 {
-    struct process *next = NULL;
-    struct process *pnext = NULL;
-    struct process *endp = NULL;
-    int min = 100;
-    int remain = 0;
-   //현재 상태가 wait일때
-    if(!current || current->status == PROCESS_WAIT){
-        goto pick_next;
-    }//next 결정해서 뽑기
-
-    if(current->age < current->lifespan){
-        list_add_tail(&current->list, &readyqueue);
-        goto pick_next;
-    }
-
-pick_next:
-    
-if(!list_empty(&readyqueue)){
-    pnext = list_first_entry(&readyqueue, struct process, list);
-    endp = list_last_entry(&readyqueue, struct process, list);
-   // printf("endp->pid : %d\n", endp->pid);
-    next = pnext;
-   // max = pnext->prio;
-   // next = pnext;
-   // pnext = list_next_entry(pnext, list);
-
-    while(pnext){
-       remain = (pnext->lifespan)-(pnext->age);
-       printf("pid,remain : %d, %d\n", pnext->pid, remain);
-
-        if(min>remain){
-            min = remain;
-            next = pnext;
-        }
-        if(pnext->pid == endp->pid)
-            break;
-        pnext = list_next_entry(pnext, list);
-        //if(pnext->pid == 0)
-          //  break;
-    }
-
-    list_del_init(&next->list);
-}
-	return next;
+	__ready_fill(__ready_remaining);
 
+	/* The current competes with the ready processes every tick */
+	if (current && current->status == PROCESS_RUNNING &&
+			current->age < current->lifespan) {
+		ready_set_add(&ready, current, __ready_remaining(current));
+	}
+	if (!ready.nr) return NULL;
 
+	schedstat_visit(ready.nr);
+	return ready_set_del(&ready, ready_set_argmin(&ready));
 }
 
-struct scheduler srtf_scheduler = {
+const struct scheduler srtf_scheduler = {
 	.name = "Shortest Remaining Time First",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
+	.cancel = fcfs_cancel, /* Use the default FCFS cancel() */
+	.finalize = ready_finalize,
+	.for_each_ready = ready_for_each,
+	.checkpoint = ready_checkpoint,
+	.restore = ready_restore,
 	.schedule = srtf_schedule,
     /* You need to check the newly created processes to implement SRTF.
 	 * Use @forked() callback to mark newly created processes */
@@ -333,6 +384,256 @@ struct scheduler srtf_scheduler = {
 };
 
 
+/***********************************************************************
+ * SJF and SRTF schedulers with burst prediction
+ *
+ * DESCRIPTION
+ *   The SJF and SRTF schedulers above look into @lifespan and @age, which
+ *   no real scheduler knows in advance. These ones predict the length of
+ *   the next CPU burst of each process from its past bursts with the
+ *   exponential averaging;
+ *
+ *     tau(n + 1) = alpha * t(n) + (1 - alpha) * tau(n)
+ *
+ *   where t(n) is the length of the n-th burst and alpha is 1/2. A CPU burst
+ *   ends when the process starts I/O or exits. A new process starts with
+ *   the latest prediction of its group, so the groups work as the classes
+ *   of the history table. Processes out of groups start with PRED_TAU_INIT.
+ *   Predictions are kept in fixed point of 1/PRED_SCALE ticks.
+ ***********************************************************************/
+#define PRED_SCALE			16
+#define PRED_TAU_INIT		(5 * PRED_SCALE)
+#define PRED_ALPHA_SHIFT	1	/* alpha = 1 / (1 << PRED_ALPHA_SHIFT) */
+
+struct pred_history {
+	unsigned int tau;		/* Prediction of the next burst */
+	unsigned int nr_bursts;	/* # of bursts predicted */
+	unsigned int error;		/* Sum of the absolute prediction errors */
+};
+
+struct pred {
+	struct pred_history history;
+	unsigned int burst_start;	/* @age when the current burst started */
+	unsigned int forked_at;
+};
+
+static struct pred_history pred_total;
+
+static inline unsigned int __pred_tau(struct process *p)
+{
+	return ((struct pred *)p->private)->history.tau;
+}
+
+/* Predicted time to finish the current burst */
+static inline unsigned int __pred_remaining(struct process *p)
+{
+	struct pred *pred = p->private;
+	unsigned int elapsed = (p->age - pred->burst_start) * PRED_SCALE;
+
+	return pred->history.tau > elapsed ? pred->history.tau - elapsed : 0;
+}
+
+static void __pred_record(struct pred_history *h, unsigned int tau, unsigned int burst)
+{
+	h->error += burst > tau ? burst - tau : tau - burst;
+	h->nr_bursts++;
+	h->tau = h->tau - (h->tau >> PRED_ALPHA_SHIFT) + (burst >> PRED_ALPHA_SHIFT);
+}
+
+static void __pred_print_error(struct pred_history *h)
+{
+	unsigned int error = h->nr_bursts ? h->error * 100 / PRED_SCALE / h->nr_bursts : 0;
+
+	printf("%d burst%s mispredicted by %d.%02d ticks on average\n",
+			h->nr_bursts, h->nr_bursts >= 2 ? "s" : "", error / 100, error % 100);
+}
+
+/**
+ * Close the burst of @p if it has just started I/O or finished, and update
+ * the predictions of the process and its class with the burst
+ */
+static void __pred_account(struct process *p)
+{
+	struct pred *pred = p->private;
+	unsigned int tau = pred->history.tau;
+	unsigned int burst;
+
+	if (p->status != PROCESS_IO && p->age < p->lifespan) return;
+
+	burst = (p->age - pred->burst_start) * PRED_SCALE;
+	pred->burst_start = p->age;
+
+	__pred_record(&pred->history, tau, burst);
+	__pred_record(&pred_total, tau, burst);
+	if (p->group) __pred_record(p->group->private, tau, burst);
+}
+
+static int pred_initialize(void)
+{
+	struct group *g;
+
+	memset(&pred_total, 0x00, sizeof(pred_total));
+
+	list_for_each_entry(g, &groups, list) {
+		struct pred_history *h = malloc(sizeof(*h));
+
+		memset(h, 0x00, sizeof(*h));
+		h->tau = PRED_TAU_INIT;
+		g->private = h;
+	}
+	return 0;
+}
+
+static void pred_finalize(void)
+{
+	struct group *g;
+
+	list_for_each_entry(g, &groups, list) {
+		struct pred_history *h = g->private;
+
+		if (h->nr_bursts) {
+			printf("- Class %s: ", g->name);
+			__pred_print_error(h);
+		}
+		free(h);
+		g->private = NULL;
+	}
+
+	printf("- Total: ");
+	__pred_print_error(&pred_total);
+}
+
+static void pred_forked(struct process *p)
+{
+	struct pred *pred = malloc(sizeof(*pred));
+
+	memset(pred, 0x00, sizeof(*pred));
+	pred->history.tau = p->group ?
+			((struct pred_history *)p->group->private)->tau : PRED_TAU_INIT;
+	pred->forked_at = ticks;
+
+	p->private = pred;
+}
+
+static void pred_exiting(struct process *p)
+{
+	struct pred *pred = p->private;
+
+	printf("- Process %d: turnaround %d ticks, ", p->pid, ticks - pred->forked_at);
+	__pred_print_error(&pred->history);
+
+	free(pred);
+	p->private = NULL;
+}
+
+static void __pred_put(struct process *p)
+{
+	checkpoint_put(p->private, sizeof(struct pred));
+}
+
+static void __pred_get(struct process *p)
+{
+	checkpoint_get(p->private, sizeof(struct pred));
+}
+
+static void pred_checkpoint(void)
+{
+	struct group *g;
+
+	checkpoint_put(&pred_total, sizeof(pred_total));
+	list_for_each_entry(g, &groups, list) {
+		checkpoint_put(g->private, sizeof(struct pred_history));
+	}
+	checkpoint_for_each_process(__pred_put);
+}
+
+static void pred_restore(void)
+{
+	struct group *g;
+
+	checkpoint_get(&pred_total, sizeof(pred_total));
+	list_for_each_entry(g, &groups, list) {
+		checkpoint_get(g->private, sizeof(struct pred_history));
+	}
+	checkpoint_for_each_process(__pred_get);
+}
+
+static struct process *psjf_schedule(void)
+{
+	struct process *next = NULL;
+	struct process *p;
+
+	if (!current) goto pick_next;
+
+	__pred_account(current);
+
+	/* Non-preemptive; keep running the current until its burst ends */
+	if (current->status == PROCESS_RUNNING && current->age < current->lifespan) {
+		return current;
+	}
+
+pick_next:
+	list_for_each_entry(p, &readyqueue, list) {
+		schedstat_visit(1);
+		if (!next || __pred_tau(p) < __pred_tau(next)) next = p;
+	}
+
+	if (next) list_del_init(&next->list);
+	return next;
+}
+
+static struct process *psrtf_schedule(void)
+{
+	struct process *next = NULL;
+	struct process *p;
+
+	if (!current) goto pick_next;
+
+	__pred_account(current);
+
+	if (current->status == PROCESS_RUNNING && current->age < current->lifespan) {
+		list_add_tail(&current->list, &readyqueue);
+	}
+
+pick_next:
+	list_for_each_entry(p, &readyqueue, list) {
+		schedstat_visit(1);
+		if (!next || __pred_remaining(p) < __pred_remaining(next)) next = p;
+	}
+
+	if (next) list_del_init(&next->list);
+	return next;
+}
+
+const struct scheduler psjf_scheduler = {
+	.name = "Shortest-Job First with burst prediction",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.cancel = fcfs_cancel,
+	.initialize = pred_initialize,
+	.finalize = pred_finalize,
+	.forked = pred_forked,
+	.exiting = pred_exiting,
+	.checkpoint = pred_checkpoint,
+	.restore = pred_restore,
+	.schedule = psjf_schedule,
+};
+
+const struct scheduler psrtf_scheduler = {
+	.name = "Shortest Remaining Time First with burst prediction",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.cancel = fcfs_cancel,
+	.initialize = pred_initialize,
+	.finalize = pred_finalize,
+	.forked = pred_forked,
+	.exiting = pred_exiting,
+	.checkpoint = pred_checkpoint,
+	.restore = pred_restore,
+	.schedule = psrtf_schedule,
+};
+
+
 /***********************************************************************
  * Round-robin scheduler
  ***********************************************************************/
@@ -342,7 +643,7 @@ static struct process * rr_schedule(void)
     struct process *endp = NULL;
 
    //현재 상태가 wait일때
-    if(!current || current->status == PROCESS_WAIT){
+    if(!current || current->status != PROCESS_RUNNING){
         goto pick_next;
     }//next 결정해서 뽑기
 
@@ -359,6 +660,7 @@ pick_next:
 		 * in the ready queue
 		 */
 		next = list_first_entry(&readyqueue, struct process, list);
+		schedstat_visit(1);
 
 		/**
 		 * Detach the process from the ready queue. Note we use list_del_init()
@@ -373,10 +675,11 @@ pick_next:
 
 }
 
-struct scheduler rr_scheduler = {
+const struct scheduler rr_scheduler = {
 	.name = "Round-Robin",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
+	.cancel = fcfs_cancel, /* Use the default FCFS cancel() */
     .schedule = rr_schedule,	/* Obviously, you should implement rr_schedule() and attach it here */
 };
 
@@ -389,19 +692,18 @@ bool prio_acquire(int resource_id)
 {
 	struct resource *r = resources + resource_id;
 
-	if (!r->owner) {
-		/* This resource is not owned by any one. Take it! */
-		r->owner = current;
+	if (resource_take(r, current)) {
+		/* This resource is available. Took it! */
 		return true;
 	}
 
-	/* OK, this resource is taken by @r->owner. */
+	/* OK, this resource is taken by others. */
 
 	/* Update the current process state */
 	current->status = PROCESS_WAIT;
 
-	/* And append current to waitqueue */
-	list_add_tail(&current->list, &r->waitqueue);
+	/* And append current to waitqueue in the priority order */
+	resource_add_waiter(r, current);
 
 	/**
 	 * And return false to indicate the resource is not available.
@@ -415,48 +717,28 @@ void prio_release(int resource_id)
 {
 	struct resource *r = resources + resource_id;
 
-	/* Ensure that the owner process is releasing the resource */
-	assert(r->owner == current);
-   // printf("owner : %d\n", r->owner->pid);
-	/* Un-own this resource */
-	r->owner = NULL;
+	unsigned int woken = 0;
 
+	/* Un-own this resource. It also ensures that the holder is releasing it */
+	resource_put(r, current);
 
-	/* Let's wake up ONE waiter (if exists) that came first */
-	if (!list_empty(&r->waitqueue)) {
-		struct process *waiter =
-				list_first_entry(&r->waitqueue, struct process, list);
-        struct process * pwaiter = waiter;
-        struct process * endp = list_last_entry(&r->waitqueue, struct process, list);
-     //   printf("endp->pid : %d\n", endp->pid);
-        int max = 0;
-        
-        while(pwaiter){
-           // printf("first : %d\n", pwaiter->pid);
-            if(max<pwaiter->prio){
-                max = pwaiter->prio;
-                waiter = pwaiter;
-             //   printf("final : %d\n", waiter->pid);
-            }
 
-            if(pwaiter->pid == endp->pid)
-                break;
-            pwaiter = list_next_entry(pwaiter, list);
-            // printf("inside while (pwaiter->pid):%d\n", pwaiter->pid); 
-        }
-       // printf("outside while (waiter->pid) : %d\n", waiter->pid);
+	/* Let's wake up the waiters with the highest priority that can take it */
+	while (!list_empty(&r->waitqueue)) {
+		struct process *waiter = resource_top_waiter(r);
+
+		if (!resource_wakeable(r, waiter, &woken)) break;
+
 		/**
 		 * Ensure the waiter  is in the wait status
 		 */
 		assert(waiter->status == PROCESS_WAIT);
 
 		/**
-		 * Take out the waiter from the waiting queue. Note we use
-		 * list_del_init() over list_del() to maintain the list head tidy
-		 * (otherwise, the framework will complain on the list head
-		 * when the process exits).
+		 * Take out the waiter from the waiting queue and the priority
+		 * order of the waiters.
 		 */
-		list_del_init(&waiter->list);
+		resource_del_waiter(r, waiter);
 
 		/* Update the process status */
 		waiter->status = PROCESS_READY;
@@ -469,55 +751,34 @@ void prio_release(int resource_id)
 	}
 }
 
-static struct process * prio_schedule(void)
+void prio_cancel(int resource_id, struct process *p)
 {
-    struct process * next = NULL;
-    struct process * pnext = NULL;
-    struct process * endp = NULL;
-    int max = 0;
-
-    if(!current || current->status == PROCESS_WAIT){
-        goto pick_next;
-    }
-
-    if(current->age < current->lifespan){
-        list_add_tail(&current->list, &readyqueue);
-        goto pick_next;
-    }
-
-pick_next:
-
-    if(!list_empty(&readyqueue)){
-        pnext = list_first_entry(&readyqueue, struct process, list);
-        endp = list_last_entry(&readyqueue, struct process, list);
-        next = pnext;
-   // max = pnext->prio;
-   // next = pnext;
-   // pnext = list_next_entry(pnext, list);
+	resource_del_waiter(resources + resource_id, p);
+}
 
-        while(pnext){
-       
-            if(max<pnext->prio){
-                max = pnext->prio;
-                next = pnext;
-            }
-            if(pnext->pid == endp->pid)
-                break;
-            pnext = list_next_entry(pnext, list);
-            //if(pnext->pid == 0)
-              //  break;
-        }
+static struct process *prio_schedule(void)
+{
+	__ready_fill(__ready_prio);
 
-        list_del_init(&next->list);
-    }
-	return next;
+	if (current && current->status == PROCESS_RUNNING &&
+			current->age < current->lifespan) {
+		ready_set_add(&ready, current, __ready_prio(current));
+	}
+	if (!ready.nr) return NULL;
 
+	schedstat_visit(ready.nr);
+	return ready_set_del(&ready, ready_set_argmax(&ready));
 }
 
-struct scheduler prio_scheduler = {
+const struct scheduler prio_scheduler = {
 	.name = "Priority",
     .acquire = prio_acquire,
     .release = prio_release,
+    .cancel = prio_cancel,
+    .finalize = ready_finalize,
+    .for_each_ready = ready_for_each,
+    .checkpoint = ready_checkpoint,
+    .restore = ready_restore,
     .schedule = prio_schedule,
 	/**
 	 * Implement your own acqure/release function to make priority
@@ -531,34 +792,95 @@ struct scheduler prio_scheduler = {
  * Priority scheduler with priority inheritance protocol
  ***********************************************************************/
 
-bool pip_acquire(int resource_id)
+/**
+ * Each process keeps the contended resources it holds in @donors, ordered by
+ * the highest priority among the waiters of each resource (@donor_prio).
+ * The effective priority of a process is the higher one of its original
+ * priority and the top of @donors. When it changes and the process is blocked,
+ * the change is propagated to the owner of the resource that the process is
+ * waiting for, and so forth along the blocking chain.
+ */
+static bool pip_donor_less(struct heap_node *a, struct heap_node *b)
+{
+	return heap_entry(a, struct resource, donor_node)->donor_prio >
+			heap_entry(b, struct resource, donor_node)->donor_prio;
+}
+
+static void __pip_update_prio(struct process *p)
+{
+	while (p) {
+		struct resource *top =
+				heap_top_entry_or_null(&p->donors, struct resource, donor_node);
+		struct resource *r = p->blocked_on;
+		unsigned int prio = p->prio_orig;
+
+		if (top && top->donor_prio > prio) prio = top->donor_prio;
+		if (prio == p->prio) break;
+
+		p->prio = prio;
+
+		if (p->status != PROCESS_WAIT || !r) break;
+		resource_update_waiter(r, p);
+
+		/* Propagate the change to the owner of the resource @p is waiting for */
+		if (!r->owner) break;
+
+		r->donor_prio = resource_top_waiter(r)->prio;
+		heap_update(&r->owner->donors, &r->donor_node);
+
+		p = r->owner;
+	}
+}
+
+static void pip_forked(struct process *p)
+{
+	INIT_HEAP(&p->donors, pip_donor_less);
+}
+
+static void pip_exiting(struct process *p)
+{
+	free(p->donors.nodes);
+}
+
+bool pip_acquire(int resource_id)
 {
 	struct resource *r = resources + resource_id;
 
-	if (!r->owner) {
-		/* This resource is not owned by any one. Take it! */
-		r->owner = current;
+	if (resource_take(r, current)) {
+		/* This resource is available. Took it! */
+
+		/**
+		 * Inherit the priority of the processes that are still waiting.
+		 * Priorities are inherited only through exclusively owned resources
+		 */
+		if (r->owner == current && !list_empty(&r->waitqueue)) {
+			r->donor_prio = resource_top_waiter(r)->prio;
+			heap_push(&current->donors, &r->donor_node);
+			__pip_update_prio(current);
+		}
 		return true;
 	}
 
-	/* OK, this resource is taken by @r->owner. */
+	/* OK, this resource is taken by others. */
 
 	/* Update the current process state */
-	if(r->owner->prio < current->prio)
-    {
-        if(r->owner->prio != r->owner->prio_orig)//already inherited
-            r->owner->prio = current->prio;//update just prio, not change prio_orig
-        else{
-            r->owner->prio_orig = r->owner->prio;
-            r->owner->prio = current->prio;
-        }
-       // printf("orig, new prio : %d, %d\n", r->owner->prio_orig, r->owner->prio);
+	current->status = PROCESS_WAIT;
 
-    }
-    current->status = PROCESS_WAIT;
+	/* And append current to waitqueue in the priority order */
+	resource_add_waiter(r, current);
 
-	/* And append current to waitqueue */
-	list_add_tail(&current->list, &r->waitqueue);
+	/* No one to donate the priority if the resource is shared */
+	if (!r->owner) return false;
+
+	/* Donate the priority to the owner, which is propagated if it is blocked */
+	if (!heap_queued(&r->donor_node)) {
+		r->donor_prio = current->prio;
+		heap_push(&r->owner->donors, &r->donor_node);
+	} else if (current->prio > r->donor_prio) {
+		r->donor_prio = current->prio;
+		heap_update(&r->owner->donors, &r->donor_node);
+	}
+	__pip_update_prio(r->owner);
 
 	/**
 	 * And return false to indicate the resource is not available.
@@ -572,54 +894,37 @@ void pip_release(int resource_id)
 {
 	struct resource *r = resources + resource_id;
 
-	/* Ensure that the owner process is releasing the resource */
-	assert(r->owner == current);
-   // printf("owner_prio_orig : %d\n", r->owner->prio_orig);
-	/* Un-own this resource */
-     if(r->owner->prio_orig != r->owner->prio)
-    {
-        r->owner->prio = r->owner->prio_orig;
-     //   printf("pid, set orig prio : %d, %d\n", r->owner->pid, r->owner->prio);
-    }
-	
-    r->owner = NULL;
+	unsigned int woken = 0;
 
+	/**
+	 * Stop inheriting the priority through this resource. The priority is
+	 * restored to what the other resources being held still donate
+	 */
+	if (r->owner == current && heap_queued(&r->donor_node)) {
+		heap_del(&current->donors, &r->donor_node);
+		__pip_update_prio(current);
+	}
 
-	/* Let's wake up ONE waiter (if exists) that came first */
-	if (!list_empty(&r->waitqueue)) {
-		struct process *waiter =
-				list_first_entry(&r->waitqueue, struct process, list);
-        struct process * pwaiter = waiter;
-        struct process * endp = list_last_entry(&r->waitqueue, struct process, list);
-     //   printf("endp->pid : %d\n", endp->pid);
-        int max = 0;
-        
-        while(pwaiter){
-           // printf("first : %d\n", pwaiter->pid);
-            if(max<pwaiter->prio){
-                max = pwaiter->prio;
-                waiter = pwaiter;
-             //   printf("final : %d\n", waiter->pid);
-            }
+	/* Un-own this resource. It also ensures that the holder is releasing it */
+	resource_put(r, current);
+
+
+	/* Let's wake up the waiters with the highest priority that can take it */
+	while (!list_empty(&r->waitqueue)) {
+		struct process *waiter = resource_top_waiter(r);
+
+		if (!resource_wakeable(r, waiter, &woken)) break;
 
-            if(pwaiter->pid == endp->pid)
-                break;
-            pwaiter = list_next_entry(pwaiter, list);
-            // printf("inside while (pwaiter->pid):%d\n", pwaiter->pid); 
-        }
-       // printf("outside while (waiter->pid) : %d\n", waiter->pid);
 		/**
 		 * Ensure the waiter  is in the wait status
 		 */
 		assert(waiter->status == PROCESS_WAIT);
 
 		/**
-		 * Take out the waiter from the waiting queue. Note we use
-		 * list_del_init() over list_del() to maintain the list head tidy
-		 * (otherwise, the framework will complain on the list head
-		 * when the process exits).
+		 * Take out the waiter from the waiting queue and the priority
+		 * order of the waiters.
 		 */
-		list_del_init(&waiter->list);
+		resource_del_waiter(r, waiter);
 
 		/* Update the process status */
 		waiter->status = PROCESS_READY;
@@ -631,6 +936,24 @@ void pip_release(int resource_id)
 	}
 }
 
+void pip_cancel(int resource_id, struct process *p)
+{
+	struct resource *r = resources + resource_id;
+
+	resource_del_waiter(r, p);
+
+	/* Withdraw the donation of @p from the owner */
+	if (!r->owner || !heap_queued(&r->donor_node)) return;
+
+	if (list_empty(&r->waitqueue)) {
+		heap_del(&r->owner->donors, &r->donor_node);
+	} else {
+		r->donor_prio = resource_top_waiter(r)->prio;
+		heap_update(&r->owner->donors, &r->donor_node);
+	}
+	__pip_update_prio(r->owner);
+}
+
 static struct process * pip_schedule(void)
 {
     struct process * next = NULL;
@@ -638,7 +961,7 @@ static struct process * pip_schedule(void)
     struct process * endp = NULL;
     int max = 0;
 
-    if(!current || current->status == PROCESS_WAIT){
+    if(!current || current->status != PROCESS_RUNNING){
         goto pick_next;
     }
 
@@ -658,6 +981,7 @@ pick_next:
    // pnext = list_next_entry(pnext, list);
 
         while(pnext){
+            schedstat_visit(1);
        
             if(max<pnext->prio){
                 max = pnext->prio;
@@ -676,14 +1000,736 @@ pick_next:
 
 }
 
-struct scheduler pip_scheduler = {
+const struct scheduler pip_scheduler = {
 	.name = "Priority + Priority Inheritance Protocol",
     .acquire = pip_acquire,
     .release = pip_release,
+    .cancel = pip_cancel,
     .schedule = pip_schedule,
+    .forked = pip_forked,
+    .exiting = pip_exiting,
     /**
 	 * Implement your own acqure/release function too to make priority
 	 * scheduler correct.
 	 */
 	/* It goes without saying to implement your own pip_schedule() */
 };
+
+
+/***********************************************************************
+ * Priority scheduler with immediate priority ceiling protocol
+ *
+ * DESCRIPTION
+ *   Acquiring a resource raises the priority of the process to the ceiling
+ *   of the resource right away. So, no process that may contend for the
+ *   resource preempts the holder, and a process is blocked for at most one
+ *   critical section of a lower priority process without chained boosting.
+ *   For the same reason, a process in a critical section is not switched
+ *   with the processes with the same priority in the round-robin way.
+ *   Like PIP, the resources being held are kept in @donors with their
+ *   ceilings as @donor_prio, so releasing a resource restores the priority
+ *   to the highest ceiling among the remaining ones in O(log n). Ceilings
+ *   apply to exclusively owned resources only.
+ ***********************************************************************/
+static void pcp_forked(struct process *p)
+{
+	INIT_HEAP(&p->donors, pip_donor_less);
+}
+
+static void pcp_exiting(struct process *p)
+{
+	free(p->donors.nodes);
+}
+
+bool pcp_acquire(int resource_id)
+{
+	struct resource *r = resources + resource_id;
+
+	if (resource_take(r, current)) {
+		/* Took the resource. Run at the ceiling if it is exclusively owned */
+		if (r->owner == current) {
+			r->donor_prio = r->ceiling;
+			heap_push(&current->donors, &r->donor_node);
+			if (r->ceiling > current->prio) current->prio = r->ceiling;
+		}
+		return true;
+	}
+
+	/**
+	 * Processes with the same priority as the ceiling may still contend for
+	 * the resource as they are scheduled in the round-robin way.
+	 */
+	current->status = PROCESS_WAIT;
+	resource_add_waiter(r, current);
+
+	return false;
+}
+
+void pcp_release(int resource_id)
+{
+	struct resource *r = resources + resource_id;
+	struct resource *top;
+
+	unsigned int woken = 0;
+
+	/* Restore the priority to the highest ceiling of the remaining ones */
+	if (r->owner == current) {
+		heap_del(&current->donors, &r->donor_node);
+
+		top = heap_top_entry_or_null(&current->donors, struct resource, donor_node);
+		current->prio = current->prio_orig;
+		if (top && top->donor_prio > current->prio) current->prio = top->donor_prio;
+	}
+
+	resource_put(r, current);
+
+	/* Wake up the waiters with the highest priority that can take it */
+	while (!list_empty(&r->waitqueue)) {
+		struct process *waiter = resource_top_waiter(r);
+
+		if (!resource_wakeable(r, waiter, &woken)) break;
+
+		assert(waiter->status == PROCESS_WAIT);
+
+		resource_del_waiter(r, waiter);
+		waiter->status = PROCESS_READY;
+		list_add_tail(&waiter->list, &readyqueue);
+	}
+}
+
+static struct process *pcp_schedule(void)
+{
+	struct process *next = NULL;
+	struct process *p;
+	bool holding = false;
+
+	if (!current || current->status != PROCESS_RUNNING ||
+			current->age >= current->lifespan) {
+		goto pick_next;
+	}
+
+	if (heap_empty(&current->donors)) {
+		/* Round-robin with the processes of the same priority */
+		list_add_tail(&current->list, &readyqueue);
+	} else {
+		/* Only a process with a higher priority can preempt the holder */
+		next = current;
+		holding = true;
+	}
+
+pick_next:
+	list_for_each_entry(p, &readyqueue, list) {
+		schedstat_visit(1);
+		if (!next || p->prio > next->prio) next = p;
+	}
+
+	if (holding) {
+		if (next == current) return current;
+		list_add_tail(&current->list, &readyqueue);
+	}
+
+	if (next) list_del_init(&next->list);
+
+	return next;
+}
+
+const struct scheduler pcp_scheduler = {
+	.name = "Priority + Immediate Priority Ceiling Protocol",
+	.acquire = pcp_acquire,
+	.release = pcp_release,
+	.cancel = prio_cancel,
+	.forked = pcp_forked,
+	.exiting = pcp_exiting,
+	.schedule = pcp_schedule,
+};
+
+
+/***********************************************************************
+ * Constant-bandwidth server (CBS) scheduler
+ *
+ * DESCRIPTION
+ *   Each process with a reservation (@budget ticks every @period ticks) is
+ *   served by its own constant-bandwidth server, and the servers are
+ *   scheduled by EDF on their deadlines. A server which runs out of the
+ *   budget is throttled until its deadline, when it is replenished with the
+ *   deadline postponed by a period (hard CBS). So a reserved process never
+ *   gets more than its bandwidth, and best-effort processes are scheduled
+ *   in the round-robin way in the leftover time. A throttled process stays
+ *   in the ready queue, and is passed over until its replenishment time.
+ ***********************************************************************/
+struct cbs {
+	unsigned int deadline;	/* Absolute deadline of the server */
+	unsigned int remaining;	/* Remaining budget of the server */
+	bool suspended;			/* The server has been idle (just forked or
+							   blocked). Apply the wake-up rule on resume */
+
+	unsigned int forked_at;	/* Tick when the process was forked */
+	unsigned int nr_throttled;
+							/* # of times the server ran out of the budget */
+};
+
+static void cbs_forked(struct process *p)
+{
+	struct cbs *cbs = malloc(sizeof(*cbs));
+
+	cbs->deadline = ticks;
+	cbs->remaining = 0;
+	cbs->suspended = true;
+	cbs->forked_at = ticks;
+	cbs->nr_throttled = 0;
+
+	p->private = cbs;
+}
+
+static void cbs_exiting(struct process *p)
+{
+	struct cbs *cbs = p->private;
+
+	printf("- Process %d: %s, turnaround %d ticks, waited %d ticks",
+			p->pid, p->budget ? "reserved" : "best-effort",
+			ticks - cbs->forked_at, ticks - cbs->forked_at - p->lifespan);
+	if (p->budget) {
+		printf(", throttled %d time%s", cbs->nr_throttled,
+				cbs->nr_throttled >= 2 ? "s" : "");
+	}
+	printf("\n");
+
+	free(cbs);
+	p->private = NULL;
+}
+
+/**
+ * CBS wake-up rule. Keep the current deadline only when the remaining budget
+ * can be consumed by the deadline without exceeding the reserved bandwidth.
+ * Otherwise, start a new period from now on.
+ */
+static void cbs_resume(struct process *p)
+{
+	struct cbs *cbs = p->private;
+
+	cbs->suspended = false;
+
+	if (cbs->deadline > ticks &&
+			cbs->remaining * p->period < (cbs->deadline - ticks) * p->budget) {
+		return;
+	}
+
+	cbs->deadline = ticks + p->period;
+	cbs->remaining = p->budget;
+}
+
+static void __cbs_put(struct process *p)
+{
+	checkpoint_put(p->private, sizeof(struct cbs));
+}
+
+static void __cbs_get(struct process *p)
+{
+	checkpoint_get(p->private, sizeof(struct cbs));
+}
+
+static void cbs_checkpoint(void)
+{
+	checkpoint_for_each_process(__cbs_put);
+}
+
+static void cbs_restore(void)
+{
+	checkpoint_for_each_process(__cbs_get);
+}
+
+static struct process *cbs_schedule(void)
+{
+	struct process *next = NULL;
+	struct process *p;
+
+	if (!current) goto pick_next;
+
+	/* @current occupied the processor in the previous tick. Charge it */
+	if (current->budget) {
+		struct cbs *cbs = current->private;
+
+		/* Ran out of the budget. Throttle the server until its deadline */
+		if (cbs->remaining && --cbs->remaining == 0) {
+			cbs->nr_throttled++;
+		}
+
+		if (current->status != PROCESS_RUNNING) {
+			cbs->suspended = true;
+		}
+	}
+
+	if (current->status != PROCESS_RUNNING) goto pick_next;
+
+	if (current->age < current->lifespan) {
+		list_add_tail(&current->list, &readyqueue);
+	}
+
+pick_next:
+	list_for_each_entry(p, &readyqueue, list) {
+		struct cbs *cbs = p->private;
+
+		schedstat_visit(1);
+		if (!p->budget) {
+			/* The first best-effort process comes next if no server is ready */
+			if (!next) next = p;
+			continue;
+		}
+
+		if (cbs->suspended) cbs_resume(p);
+
+		if (!cbs->remaining) {
+			if (ticks < cbs->deadline) continue;
+
+			/* Replenish the throttled server at its deadline */
+			cbs->deadline = ticks + p->period;
+			cbs->remaining = p->budget;
+		}
+
+		if (!next || !next->budget ||
+				cbs->deadline < ((struct cbs *)next->private)->deadline) {
+			next = p;
+		}
+	}
+
+	if (next) list_del_init(&next->list);
+
+	return next;
+}
+
+const struct scheduler cbs_scheduler = {
+	.name = "Constant-Bandwidth Server",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.cancel = fcfs_cancel,
+	.forked = cbs_forked,
+	.exiting = cbs_exiting,
+	.checkpoint = cbs_checkpoint,
+	.restore = cbs_restore,
+	.schedule = cbs_schedule,
+};
+
+
+/***********************************************************************
+ * Hierarchical fair-share scheduler
+ *
+ * DESCRIPTION
+ *   Groups form a tree (e.g., tenant -> service -> process) by their names.
+ *   Each group keeps its runnable children (sub-groups and processes) in its
+ *   own runqueue ordered by their virtual runtime, which advances inversely
+ *   to their weights as they run. The scheduler picks the child with the
+ *   least virtual runtime level by level from the root, so siblings share
+ *   the processor in proportion to their weights no matter how many
+ *   processes they have underneath.
+ ***********************************************************************/
+#define HFS_VRUNTIME_UNIT	(1UL << 20)
+							/* Virtual runtime of a tick at weight 1 */
+#define HFS_SHARE_WINDOW	100
+							/* Report the CPU share every this ticks */
+
+struct hfs_entity {
+	unsigned long vruntime;	/* Virtual runtime */
+	unsigned int weight;	/* Weight among the siblings */
+
+	struct hfs_entity *parent;
+							/* The group entity that this entity belongs to */
+	struct heap_node node;	/* Heap node in the runqueue of @parent */
+
+	struct process *process;
+							/* The process for process entities */
+	struct group *group;	/* The group for group entities */
+
+	struct heap runqueue;	/* Runnable children of the group entity.
+							   Queued in @parent iff not empty */
+	unsigned long min_vruntime;
+							/* Virtual runtime picked last in @runqueue */
+
+	unsigned int nr_ticks;	/* # of ticks consumed */
+	unsigned int window_ticks;
+							/* # of ticks consumed in the report window */
+};
+
+/* Entity for the root of the hierarchy */
+static struct hfs_entity hfs_root;
+
+static unsigned int hfs_window_start = 0;
+
+static bool hfs_less(struct heap_node *a, struct heap_node *b)
+{
+	return heap_entry(a, struct hfs_entity, node)->vruntime <
+			heap_entry(b, struct hfs_entity, node)->vruntime;
+}
+
+static struct hfs_entity *__hfs_group_entity(struct group *g)
+{
+	struct hfs_entity *e;
+
+	if (!g) return &hfs_root;
+	if (g->private) return g->private;
+
+	e = malloc(sizeof(*e));
+	memset(e, 0x00, sizeof(*e));
+
+	e->weight = g->weight;
+	e->parent = __hfs_group_entity(g->parent);
+	e->group = g;
+	e->vruntime = e->parent->min_vruntime;
+	INIT_HEAP_NODE(&e->node);
+	INIT_HEAP(&e->runqueue, hfs_less);
+
+	g->private = e;
+	return e;
+}
+
+/**
+ * Enqueue @e into its parent, and the parent into the grandparent if the
+ * parent has had no runnable child, and so on
+ */
+static void __hfs_enqueue(struct hfs_entity *e)
+{
+	for (; e->parent; e = e->parent) {
+		struct hfs_entity *parent = e->parent;
+		bool was_empty = heap_empty(&parent->runqueue);
+
+		/* Do not let an entity which has been idle for long hog the processor */
+		if (e->vruntime < parent->min_vruntime) {
+			e->vruntime = parent->min_vruntime;
+		}
+		heap_push(&parent->runqueue, &e->node);
+
+		if (!was_empty) break;
+	}
+}
+
+/**
+ * Dequeue @e from its parent, and the parent from the grandparent if the
+ * parent has no runnable child anymore, and so on
+ */
+static void __hfs_dequeue(struct hfs_entity *e)
+{
+	for (; e->parent; e = e->parent) {
+		heap_del(&e->parent->runqueue, &e->node);
+
+		if (!heap_empty(&e->parent->runqueue)) break;
+	}
+}
+
+/**
+ * Walk down from the root by picking the least virtual runtime on each level
+ */
+static struct hfs_entity *__hfs_pick(void)
+{
+	struct hfs_entity *e = &hfs_root;
+
+	while (!e->process) {
+		struct heap_node *node = heap_top(&e->runqueue);
+		if (!node) return NULL;
+
+		schedstat_visit(1);
+		e = heap_entry(node, struct hfs_entity, node);
+		if (e->vruntime > e->parent->min_vruntime) {
+			e->parent->min_vruntime = e->vruntime;
+		}
+	}
+	return e;
+}
+
+/**
+ * Charge a tick to @e and its ancestors
+ */
+static void __hfs_charge(struct hfs_entity *e)
+{
+	for (; e->parent; e = e->parent) {
+		e->vruntime += HFS_VRUNTIME_UNIT / e->weight;
+		e->nr_ticks++;
+		e->window_ticks++;
+
+		if (heap_queued(&e->node)) heap_update(&e->parent->runqueue, &e->node);
+	}
+	hfs_root.nr_ticks++;
+	hfs_root.window_ticks++;
+}
+
+static void __hfs_report_window(void)
+{
+	struct group *g;
+
+	printf("- Share in ticks %d-%d:", hfs_window_start, ticks - 1);
+	list_for_each_entry(g, &groups, list) {
+		struct hfs_entity *e = g->private;
+		if (!e) continue;
+
+		printf(" %s %d%%", g->name,
+				hfs_root.window_ticks ? e->window_ticks * 100 / hfs_root.window_ticks : 0);
+		e->window_ticks = 0;
+	}
+	printf("\n");
+
+	hfs_root.window_ticks = 0;
+	hfs_window_start = ticks;
+}
+
+static int hfs_initialize(void)
+{
+	memset(&hfs_root, 0x00, sizeof(hfs_root));
+	INIT_HEAP(&hfs_root.runqueue, hfs_less);
+	return 0;
+}
+
+static void hfs_finalize(void)
+{
+	struct group *g;
+
+	if (ticks > hfs_window_start) __hfs_report_window();
+
+	list_for_each_entry(g, &groups, list) {
+		struct hfs_entity *e = g->private;
+		if (!e) continue;
+
+		printf("- Group %s: %d ticks with weight %d (%d%%)\n",
+				g->name, e->nr_ticks, e->weight,
+				hfs_root.nr_ticks ? e->nr_ticks * 100 / hfs_root.nr_ticks : 0);
+	}
+}
+
+static void hfs_forked(struct process *p)
+{
+	struct hfs_entity *e = malloc(sizeof(*e));
+
+	memset(e, 0x00, sizeof(*e));
+	e->weight = GROUP_DEFAULT_WEIGHT;
+	e->parent = __hfs_group_entity(p->group);
+	e->process = p;
+	e->vruntime = e->parent->min_vruntime;
+	INIT_HEAP_NODE(&e->node);
+
+	p->private = e;
+}
+
+static void hfs_exiting(struct process *p)
+{
+	free(p->private);
+	p->private = NULL;
+}
+
+/* Walk down the runqueues from @e in the array order of the heaps */
+static void __hfs_for_each(struct hfs_entity *e, void (*fn)(struct process *))
+{
+	for (int i = 0; i < e->runqueue.nr_nodes; i++) {
+		struct hfs_entity *child =
+				heap_entry(e->runqueue.nodes[i], struct hfs_entity, node);
+
+		if (child->process) {
+			fn(child->process);
+		} else {
+			__hfs_for_each(child, fn);
+		}
+	}
+}
+
+static void hfs_for_each_ready(void (*fn)(struct process *))
+{
+	__hfs_for_each(&hfs_root, fn);
+}
+
+static void __hfs_put_entity(struct hfs_entity *e)
+{
+	checkpoint_put(&e->vruntime, sizeof(e->vruntime));
+	checkpoint_put(&e->min_vruntime, sizeof(e->min_vruntime));
+	checkpoint_put_uint(e->nr_ticks);
+	checkpoint_put_uint(e->window_ticks);
+}
+
+static void __hfs_get_entity(struct hfs_entity *e)
+{
+	checkpoint_get(&e->vruntime, sizeof(e->vruntime));
+	checkpoint_get(&e->min_vruntime, sizeof(e->min_vruntime));
+	e->nr_ticks = checkpoint_get_uint();
+	e->window_ticks = checkpoint_get_uint();
+}
+
+static void __hfs_put_process(struct process *p)
+{
+	__hfs_put_entity(p->private);
+}
+
+static void __hfs_get_process(struct process *p)
+{
+	__hfs_get_entity(p->private);
+}
+
+/**
+ * Save the children in the runqueue of @e in the array order, so that pushing
+ * them back in the order rebuilds the same heap. A group entity is referred
+ * to by the position of its group
+ */
+static void __hfs_put_runqueue(struct hfs_entity *e)
+{
+	checkpoint_put_uint(e->runqueue.nr_nodes);
+	for (int i = 0; i < e->runqueue.nr_nodes; i++) {
+		struct hfs_entity *child =
+				heap_entry(e->runqueue.nodes[i], struct hfs_entity, node);
+
+		checkpoint_put_process(child->process);
+		if (!child->process) {
+			struct group *g;
+			unsigned int index = 0;
+
+			list_for_each_entry(g, &groups, list) {
+				if (g == child->group) break;
+				index++;
+			}
+			checkpoint_put_uint(index);
+		}
+	}
+}
+
+static void __hfs_get_runqueue(struct hfs_entity *e)
+{
+	unsigned int nr = checkpoint_get_uint();
+
+	for (int i = 0; i < nr; i++) {
+		struct process *p = checkpoint_get_process();
+		struct hfs_entity *child = NULL;
+
+		if (p) {
+			child = p->private;
+		} else {
+			struct group *g;
+			unsigned int index = checkpoint_get_uint();
+
+			list_for_each_entry(g, &groups, list) {
+				if (!index--) {
+					child = g->private;
+					break;
+				}
+			}
+		}
+		assert(child && child->parent == e);
+		heap_push(&e->runqueue, &child->node);
+	}
+}
+
+static void hfs_checkpoint(void)
+{
+	struct group *g;
+
+	checkpoint_put_uint(hfs_window_start);
+	__hfs_put_entity(&hfs_root);
+	list_for_each_entry(g, &groups, list) {
+		checkpoint_put_uint(!!g->private);
+		if (g->private) __hfs_put_entity(g->private);
+	}
+	checkpoint_for_each_process(__hfs_put_process);
+
+	__hfs_put_runqueue(&hfs_root);
+	list_for_each_entry(g, &groups, list) {
+		if (g->private) __hfs_put_runqueue(g->private);
+	}
+}
+
+static void hfs_restore(void)
+{
+	struct group *g;
+
+	hfs_window_start = checkpoint_get_uint();
+	__hfs_get_entity(&hfs_root);
+	list_for_each_entry(g, &groups, list) {
+		if (checkpoint_get_uint()) __hfs_get_entity(__hfs_group_entity(g));
+	}
+	checkpoint_for_each_process(__hfs_get_process);
+
+	/* Queue the entities after all their virtual runtimes are in place */
+	__hfs_get_runqueue(&hfs_root);
+	list_for_each_entry(g, &groups, list) {
+		if (g->private) __hfs_get_runqueue(g->private);
+	}
+}
+
+static struct process *hfs_schedule(void)
+{
+	struct process *p, *tmp;
+	struct hfs_entity *next;
+
+	if (current) {
+		__hfs_charge(current->private);
+
+		if (current->status == PROCESS_RUNNING &&
+				current->age < current->lifespan) {
+			list_add_tail(&current->list, &readyqueue);
+		}
+	}
+
+	/* Move the processes that became ready (forked, woken up, ...) into the tree */
+	list_for_each_entry_safe(p, tmp, &readyqueue, list) {
+		list_del_init(&p->list);
+		__hfs_enqueue(p->private);
+	}
+
+	if (ticks >= hfs_window_start + HFS_SHARE_WINDOW) __hfs_report_window();
+
+	next = __hfs_pick();
+	if (!next) return NULL;
+
+	__hfs_dequeue(next);
+	return next->process;
+}
+
+const struct scheduler hfs_scheduler = {
+	.name = "Hierarchical Fair-Share",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.cancel = fcfs_cancel,
+	.initialize = hfs_initialize,
+	.finalize = hfs_finalize,
+	.forked = hfs_forked,
+	.exiting = hfs_exiting,
+	.for_each_ready = hfs_for_each_ready,
+	.checkpoint = hfs_checkpoint,
+	.restore = hfs_restore,
+	.schedule = hfs_schedule,
+};
+
+
+/***********************************************************************
+ * Critical-path first scheduler
+ *
+ * DESCRIPTION
+ *   Processes chained by the @after property form DAGs, and the makespan
+ *   of a DAG is bounded by its longest path. This scheduler runs the process
+ *   with the longest remaining path (@critical_path - @age) first so that
+ *   the processes on the critical paths do not lag behind, and re-evaluates
+ *   the choice on every tick. The processes with the same remaining path are
+ *   scheduled in the round-robin way.
+ ***********************************************************************/
+static inline unsigned int __cp_remaining(struct process *p)
+{
+	return p->critical_path - p->age;
+}
+
+static struct process *cp_schedule(void)
+{
+	struct process *next = NULL;
+	struct process *p;
+
+	if (current && current->status == PROCESS_RUNNING &&
+			current->age < current->lifespan) {
+		list_add_tail(&current->list, &readyqueue);
+	}
+
+	list_for_each_entry(p, &readyqueue, list) {
+		schedstat_visit(1);
+		if (!next || __cp_remaining(p) > __cp_remaining(next)) next = p;
+	}
+
+	if (next) list_del_init(&next->list);
+	return next;
+}
+
+const struct scheduler cp_scheduler = {
+	.name = "Critical-Path First",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.cancel = fcfs_cancel,
+	.schedule = cp_schedule,
+};
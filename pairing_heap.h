@@ -0,0 +1,178 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __PAIRING_HEAP_H__
+#define __PAIRING_HEAP_H__
+
+/*
+ * Intrusive pairing heap in the same flavor as heap.h.
+ *
+ * Embed struct pairing_node into the structure to keep in the heap, and get
+ * the structure back with pairing_entry(). The heap is ordered by @less().
+ * Insertions are O(1) and the least node is removed in O(log n) amortized.
+ * Unlike heap.h, the heap needs no array, so pushing never allocates memory.
+ * The nodes with the same key come out in no particular order.
+ *
+ * Include list_head.h (for container_of) before this file.
+ */
+
+struct pairing_node {
+	struct pairing_node *child;	/* The first child */
+	struct pairing_node *next;	/* The next sibling */
+	struct pairing_node *prev;	/* The previous sibling, or the parent
+								   for the first child */
+};
+
+struct pairing_heap {
+	struct pairing_node *root;
+	unsigned int nr_nodes;
+	bool (*less)(struct pairing_node *, struct pairing_node *);
+};
+
+#define pairing_entry(ptr, type, member) \
+	container_of(ptr, type, member)
+
+static inline void INIT_PAIRING_HEAP(struct pairing_heap *heap,
+		bool (*less)(struct pairing_node *, struct pairing_node *))
+{
+	heap->root = NULL;
+	heap->nr_nodes = 0;
+	heap->less = less;
+}
+
+static inline bool pairing_empty(const struct pairing_heap *heap)
+{
+	return heap->root == NULL;
+}
+
+/**
+ * pairing_top - get the least node in the heap, or NULL if the heap is empty
+ */
+static inline struct pairing_node *pairing_top(const struct pairing_heap *heap)
+{
+	return heap->root;
+}
+
+/* Link two roots, and return the new root */
+static inline struct pairing_node *__pairing_meld(struct pairing_heap *heap,
+		struct pairing_node *a, struct pairing_node *b)
+{
+	if (heap->less(b, a)) {
+		struct pairing_node *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	b->prev = a;
+	b->next = a->child;
+	if (a->child) a->child->prev = b;
+	a->child = b;
+
+	a->next = a->prev = NULL;
+	return a;
+}
+
+/* Meld the siblings from @first into one in the two-pass way */
+static inline struct pairing_node *__pairing_merge_pairs(struct pairing_heap *heap,
+		struct pairing_node *first)
+{
+	struct pairing_node *pairs = NULL;
+	struct pairing_node *root;
+
+	/* Meld them in pairs from left to right, stacking up the results */
+	while (first) {
+		struct pairing_node *a = first;
+		struct pairing_node *b = a->next;
+
+		if (b) {
+			first = b->next;
+			a = __pairing_meld(heap, a, b);
+		} else {
+			first = NULL;
+		}
+		a->next = pairs;
+		pairs = a;
+	}
+
+	/* And meld the pairs from right to left */
+	root = pairs;
+	if (!root) return NULL;
+
+	pairs = root->next;
+	root->next = root->prev = NULL;
+	while (pairs) {
+		struct pairing_node *next = pairs->next;
+		root = __pairing_meld(heap, root, pairs);
+		pairs = next;
+	}
+	return root;
+}
+
+/**
+ * pairing_push - add a new node into the heap
+ */
+static inline void pairing_push(struct pairing_heap *heap, struct pairing_node *node)
+{
+	node->child = node->next = node->prev = NULL;
+	heap->root = heap->root ? __pairing_meld(heap, heap->root, node) : node;
+	heap->nr_nodes++;
+}
+
+/**
+ * pairing_del - remove @node from the heap
+ */
+static inline void pairing_del(struct pairing_heap *heap, struct pairing_node *node)
+{
+	struct pairing_node *sub = __pairing_merge_pairs(heap, node->child);
+
+	heap->nr_nodes--;
+
+	if (node == heap->root) {
+		heap->root = sub;
+		return;
+	}
+
+	/* Detach the subtree of @node, and meld its children back */
+	if (node->prev->child == node) {
+		node->prev->child = node->next;
+	} else {
+		node->prev->next = node->next;
+	}
+	if (node->next) node->next->prev = node->prev;
+
+	if (sub) heap->root = __pairing_meld(heap, heap->root, sub);
+}
+
+/**
+ * pairing_update - re-position @node after its key is changed
+ */
+static inline void pairing_update(struct pairing_heap *heap, struct pairing_node *node)
+{
+	pairing_del(heap, node);
+	pairing_push(heap, node);
+}
+
+/**
+ * pairing_pop - remove the least node from the heap and return it
+ */
+static inline struct pairing_node *pairing_pop(struct pairing_heap *heap)
+{
+	struct pairing_node *top = heap->root;
+
+	if (top) pairing_del(heap, top);
+	return top;
+}
+
+#endif
@@ -0,0 +1,125 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __PRIO_INDEX_H__
+#define __PRIO_INDEX_H__
+
+/*
+ * Bitmap priority index as in the O(1) scheduler of Linux.
+ *
+ * The index keeps a FIFO list per priority level and a bitmap of the levels
+ * with nodes. Insertions and deletions are O(1), and the node with the
+ * highest priority (the first one among the nodes with the priority) is found
+ * by scanning PRIO_INDEX_NR / 64 words of the bitmap. The priority of a node
+ * is limited below PRIO_INDEX_NR, and should not change while it is indexed.
+ *
+ * Embed struct prio_index_node into the structure to keep in the index, and
+ * get the structure back with prio_index_entry().
+ *
+ * Include list_head.h and assert.h before this file.
+ */
+
+#define PRIO_INDEX_NR		128
+#define PRIO_INDEX_BITS		(sizeof(unsigned long) * 8)
+#define PRIO_INDEX_WORDS	((PRIO_INDEX_NR + PRIO_INDEX_BITS - 1) / PRIO_INDEX_BITS)
+
+struct prio_index_node {
+	struct list_head list;
+	unsigned int prio;
+};
+
+struct prio_index {
+	unsigned long bitmap[PRIO_INDEX_WORDS];
+	struct list_head queues[PRIO_INDEX_NR];
+	unsigned int nr_nodes;
+};
+
+#define prio_index_entry(ptr, type, member) \
+	container_of(ptr, type, member)
+
+static inline void INIT_PRIO_INDEX(struct prio_index *index)
+{
+	for (int i = 0; i < PRIO_INDEX_WORDS; i++) {
+		index->bitmap[i] = 0;
+	}
+	for (int i = 0; i < PRIO_INDEX_NR; i++) {
+		INIT_LIST_HEAD(index->queues + i);
+	}
+	index->nr_nodes = 0;
+}
+
+static inline bool prio_index_empty(const struct prio_index *index)
+{
+	return index->nr_nodes == 0;
+}
+
+/**
+ * prio_index_add - add @node at the tail of the nodes with priority @prio
+ */
+static inline void prio_index_add(struct prio_index *index,
+		struct prio_index_node *node, unsigned int prio)
+{
+	assert(prio < PRIO_INDEX_NR);
+
+	node->prio = prio;
+	list_add_tail(&node->list, index->queues + prio);
+	index->bitmap[prio / PRIO_INDEX_BITS] |= 1UL << (prio % PRIO_INDEX_BITS);
+	index->nr_nodes++;
+}
+
+/**
+ * prio_index_del - remove @node from the index
+ */
+static inline void prio_index_del(struct prio_index *index, struct prio_index_node *node)
+{
+	unsigned int prio = node->prio;
+
+	list_del_init(&node->list);
+	if (list_empty(index->queues + prio)) {
+		index->bitmap[prio / PRIO_INDEX_BITS] &= ~(1UL << (prio % PRIO_INDEX_BITS));
+	}
+	index->nr_nodes--;
+}
+
+/**
+ * prio_index_top - get the first node with the highest priority, or NULL if
+ * the index is empty
+ */
+static inline struct prio_index_node *prio_index_top(const struct prio_index *index)
+{
+	for (int i = PRIO_INDEX_WORDS - 1; i >= 0; i--) {
+		unsigned int prio;
+
+		if (!index->bitmap[i]) continue;
+
+		prio = i * PRIO_INDEX_BITS + PRIO_INDEX_BITS - 1 - __builtin_clzl(index->bitmap[i]);
+		return list_first_entry(index->queues + prio, struct prio_index_node, list);
+	}
+	return NULL;
+}
+
+/**
+ * prio_index_pop - remove the first node with the highest priority from the
+ * index and return it
+ */
+static inline struct prio_index_node *prio_index_pop(struct prio_index *index)
+{
+	struct prio_index_node *top = prio_index_top(index);
+
+	if (top) prio_index_del(index, top);
+	return top;
+}
+
+#endif
@@ -17,12 +17,17 @@
 #define __PROCESS_H__
 
 struct list_head;
+struct group;
+struct resource;
+struct program;
 
 enum process_status {
 	PROCESS_READY,		/* Process is ready to run */
 	PROCESS_RUNNING,	/* The process is now running */
 	PROCESS_WAIT,		/* The process is waiting for some resource */
 	PROCESS_EXIT,		/* The process is exited */
+	PROCESS_THROTTLED,	/* The process is parked as its group is throttled */
+	PROCESS_IO,			/* The process is blocked on I/O */
 };
 
 struct process {
@@ -46,8 +51,42 @@ struct process {
 	 */
 	unsigned int prio_orig;	/* The original priority of the process */
 
+	bool acquire_shared;	/* True if the process is acquiring (or waiting
+							   for) a resource in the shared mode */
+
+	struct resource *blocked_on;
+							/* The resource that the process is waiting for.
+							   Valid only in PROCESS_WAIT status */
+
+	struct heap_node wait_node;
+	unsigned long wait_seq;	/* To order waiters in a resource. See resource.h */
+
+	struct heap donors;		/* Resources being held and waited for by others,
+							   ordered by their @donor_prio */
+
+	/**
+	 * CPU reservation of the process. The process is guaranteed @budget ticks
+	 * in every @period ticks by reservation-aware schedulers. Both are 0 for
+	 * best-effort processes
+	 */
+	unsigned int budget;
+	unsigned int period;
+
+	struct group *group;	/* The group that the process belongs to. NULL if
+							   the process does not belong to any group */
+
+	unsigned int critical_path;
+							/* The longest sum of lifespans along the paths
+							   from the process to the end of its dependency
+							   DAG, including its own lifespan. Computed by
+							   the framework when processes are loaded */
+
+	void *private;			/* Scheduler-private data. Allocate it in
+							   forked() and free it in exiting() */
 
 	/* DO NOT ACCESS FOLLOWING VARIABLES */
+	unsigned int __index;		/* Index in the process table */
+
 	unsigned int __starts_at;	/* When to fork the process */
 
 	struct list_head __resources_to_acquire;
@@ -55,6 +94,20 @@ struct process {
 
 	struct list_head __resources_holding;
 								/* Resources that the process is currently holding */
+
+	struct list_head __io_to_perform;
+								/* Schedule to perform I/O */
+
+	unsigned int __nr_waiting_for;
+								/* # of predecessors that are not exited yet */
+	unsigned int __nr_successors;
+	struct process **__successors;
+								/* Processes to fork after this one exits */
+
+	struct program *__program;	/* Program to run instead of the scheduled
+								   acquisitions and I/O. NULL if not given */
+
+	bool __forked;				/* Forked already */
 };
 
 /**
@@ -62,4 +115,10 @@ struct process {
  */
 void dump_status(void);
 
+/**
+ * Call @fn for each ready process, including the ones the scheduler keeps
+ * out of the ready queue. See for_each_ready() in sched.h
+ */
+void for_each_ready_process(void (*fn)(struct process *));
+
 #endif
@@ -0,0 +1,315 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __RBTREE_H__
+#define __RBTREE_H__
+
+/*
+ * Intrusive red-black tree in the same flavor as heap.h.
+ *
+ * Embed struct rb_node into the structure to keep in the tree, and get the
+ * structure back with rb_entry(). The tree is ordered by @less(), and nodes
+ * with the same key are kept in the insertion order. The leftmost (least)
+ * node is cached, so rb_first() is O(1) whereas insertions and deletions
+ * are O(log n). The nodes can be walked in order with rb_next().
+ *
+ * Include list_head.h (for container_of) before this file.
+ */
+
+struct rb_node {
+	struct rb_node *parent;
+	struct rb_node *left;
+	struct rb_node *right;
+	bool red;
+};
+
+struct rb_root {
+	struct rb_node *root;
+	struct rb_node *leftmost;
+	unsigned int nr_nodes;
+	bool (*less)(struct rb_node *, struct rb_node *);
+};
+
+#define rb_entry(ptr, type, member) \
+	container_of(ptr, type, member)
+
+static inline void INIT_RB_ROOT(struct rb_root *tree,
+		bool (*less)(struct rb_node *, struct rb_node *))
+{
+	tree->root = NULL;
+	tree->leftmost = NULL;
+	tree->nr_nodes = 0;
+	tree->less = less;
+}
+
+static inline bool rb_empty(const struct rb_root *tree)
+{
+	return tree->root == NULL;
+}
+
+/**
+ * rb_first - get the least node in the tree, or NULL if the tree is empty
+ */
+static inline struct rb_node *rb_first(const struct rb_root *tree)
+{
+	return tree->leftmost;
+}
+
+/**
+ * rb_next - get the node following @node in order, or NULL if it is the last
+ */
+static inline struct rb_node *rb_next(struct rb_node *node)
+{
+	if (node->right) {
+		node = node->right;
+		while (node->left) node = node->left;
+		return node;
+	}
+
+	while (node->parent && node == node->parent->right) {
+		node = node->parent;
+	}
+	return node->parent;
+}
+
+/* Put @new in the place of @old under the parent of @old */
+static inline void __rb_transplant(struct rb_root *tree,
+		struct rb_node *old, struct rb_node *new)
+{
+	if (!old->parent) {
+		tree->root = new;
+	} else if (old == old->parent->left) {
+		old->parent->left = new;
+	} else {
+		old->parent->right = new;
+	}
+	if (new) new->parent = old->parent;
+}
+
+static inline void __rb_rotate_left(struct rb_root *tree, struct rb_node *node)
+{
+	struct rb_node *right = node->right;
+
+	node->right = right->left;
+	if (right->left) right->left->parent = node;
+
+	__rb_transplant(tree, node, right);
+	right->left = node;
+	node->parent = right;
+}
+
+static inline void __rb_rotate_right(struct rb_root *tree, struct rb_node *node)
+{
+	struct rb_node *left = node->left;
+
+	node->left = left->right;
+	if (left->right) left->right->parent = node;
+
+	__rb_transplant(tree, node, left);
+	left->right = node;
+	node->parent = left;
+}
+
+static inline bool __rb_red(const struct rb_node *node)
+{
+	return node && node->red;
+}
+
+/**
+ * rb_insert - add @node into the tree after the nodes with the same key
+ */
+static inline void rb_insert(struct rb_root *tree, struct rb_node *node)
+{
+	struct rb_node **link = &tree->root;
+	struct rb_node *parent = NULL;
+	bool leftmost = true;
+
+	while (*link) {
+		parent = *link;
+		if (tree->less(node, parent)) {
+			link = &parent->left;
+		} else {
+			link = &parent->right;
+			leftmost = false;
+		}
+	}
+
+	node->parent = parent;
+	node->left = node->right = NULL;
+	node->red = true;
+	*link = node;
+
+	if (leftmost) tree->leftmost = node;
+	tree->nr_nodes++;
+
+	/* Resolve the red node under the red parent */
+	while ((parent = node->parent) && parent->red) {
+		struct rb_node *gparent = parent->parent;
+
+		if (parent == gparent->left) {
+			struct rb_node *uncle = gparent->right;
+
+			if (__rb_red(uncle)) {
+				parent->red = uncle->red = false;
+				gparent->red = true;
+				node = gparent;
+				continue;
+			}
+			if (node == parent->right) {
+				__rb_rotate_left(tree, parent);
+				node = parent;
+				parent = node->parent;
+			}
+			parent->red = false;
+			gparent->red = true;
+			__rb_rotate_right(tree, gparent);
+		} else {
+			struct rb_node *uncle = gparent->left;
+
+			if (__rb_red(uncle)) {
+				parent->red = uncle->red = false;
+				gparent->red = true;
+				node = gparent;
+				continue;
+			}
+			if (node == parent->left) {
+				__rb_rotate_right(tree, parent);
+				node = parent;
+				parent = node->parent;
+			}
+			parent->red = false;
+			gparent->red = true;
+			__rb_rotate_left(tree, gparent);
+		}
+	}
+	tree->root->red = false;
+}
+
+/* Restore the black height lost under @parent on the side of @node */
+static inline void __rb_del_fixup(struct rb_root *tree,
+		struct rb_node *node, struct rb_node *parent)
+{
+	while (node != tree->root && !__rb_red(node)) {
+		if (node == parent->left) {
+			struct rb_node *sibling = parent->right;
+
+			if (sibling->red) {
+				sibling->red = false;
+				parent->red = true;
+				__rb_rotate_left(tree, parent);
+				sibling = parent->right;
+			}
+			if (!__rb_red(sibling->left) && !__rb_red(sibling->right)) {
+				sibling->red = true;
+				node = parent;
+				parent = node->parent;
+				continue;
+			}
+			if (!__rb_red(sibling->right)) {
+				sibling->left->red = false;
+				sibling->red = true;
+				__rb_rotate_right(tree, sibling);
+				sibling = parent->right;
+			}
+			sibling->red = parent->red;
+			parent->red = false;
+			sibling->right->red = false;
+			__rb_rotate_left(tree, parent);
+		} else {
+			struct rb_node *sibling = parent->left;
+
+			if (sibling->red) {
+				sibling->red = false;
+				parent->red = true;
+				__rb_rotate_right(tree, parent);
+				sibling = parent->left;
+			}
+			if (!__rb_red(sibling->left) && !__rb_red(sibling->right)) {
+				sibling->red = true;
+				node = parent;
+				parent = node->parent;
+				continue;
+			}
+			if (!__rb_red(sibling->left)) {
+				sibling->right->red = false;
+				sibling->red = true;
+				__rb_rotate_left(tree, sibling);
+				sibling = parent->left;
+			}
+			sibling->red = parent->red;
+			parent->red = false;
+			sibling->left->red = false;
+			__rb_rotate_right(tree, parent);
+		}
+		node = tree->root;
+	}
+	if (node) node->red = false;
+}
+
+/**
+ * rb_del - remove @node from the tree
+ */
+static inline void rb_del(struct rb_root *tree, struct rb_node *node)
+{
+	struct rb_node *child, *parent;
+	bool red = node->red;
+
+	if (tree->leftmost == node) tree->leftmost = rb_next(node);
+
+	if (!node->left) {
+		child = node->right;
+		parent = node->parent;
+		__rb_transplant(tree, node, child);
+	} else if (!node->right) {
+		child = node->left;
+		parent = node->parent;
+		__rb_transplant(tree, node, child);
+	} else {
+		/* Replace @node with its successor, which has no left child */
+		struct rb_node *next = node->right;
+		while (next->left) next = next->left;
+
+		red = next->red;
+		child = next->right;
+		if (next->parent == node) {
+			parent = next;
+		} else {
+			parent = next->parent;
+			__rb_transplant(tree, next, child);
+			next->right = node->right;
+			next->right->parent = next;
+		}
+		__rb_transplant(tree, node, next);
+		next->left = node->left;
+		next->left->parent = next;
+		next->red = node->red;
+	}
+	tree->nr_nodes--;
+
+	if (!red) __rb_del_fixup(tree, child, parent);
+}
+
+/**
+ * rb_pop - remove the least node from the tree and return it
+ */
+static inline struct rb_node *rb_pop(struct rb_root *tree)
+{
+	struct rb_node *first = rb_first(tree);
+
+	if (first) rb_del(tree, first);
+	return first;
+}
+
+#endif
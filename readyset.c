@@ -0,0 +1,346 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "types.h"
+#include "readyset.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CONFIG_SELECT_X86
+#endif
+
+static int __compare_order(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * Renumber the processes from 0 in the order they are added, so that the
+ * sequence numbers do not wrap around
+ */
+static void __renumber(struct ready_set *rs)
+{
+	unsigned long long *order = malloc(sizeof(*order) * (rs->nr + 1));
+
+	for (unsigned int i = 0; i < rs->nr; i++) {
+		order[i] = (unsigned long long)rs->seqs[i] << 32 | i;
+	}
+	qsort(order, rs->nr, sizeof(*order), __compare_order);
+	for (unsigned int i = 0; i < rs->nr; i++) {
+		rs->seqs[order[i] & UINT_MAX] = i;
+	}
+	rs->seq = rs->nr;
+
+	free(order);
+}
+
+void ready_set_add(struct ready_set *rs, struct process *p, unsigned int key)
+{
+	if (rs->nr == rs->size) {
+		rs->size = rs->size ? rs->size * 2 : 64;
+		rs->processes = realloc(rs->processes, sizeof(*rs->processes) * rs->size);
+		rs->keys = realloc(rs->keys, sizeof(*rs->keys) * rs->size);
+		rs->seqs = realloc(rs->seqs, sizeof(*rs->seqs) * rs->size);
+	}
+	/* UINT_MAX stands for no process in the kernels */
+	if (rs->seq == UINT_MAX) __renumber(rs);
+
+	rs->processes[rs->nr] = p;
+	rs->keys[rs->nr] = key;
+	rs->seqs[rs->nr] = rs->seq++;
+	rs->nr++;
+}
+
+struct process *ready_set_del(struct ready_set *rs, unsigned int index)
+{
+	struct process *p = rs->processes[index];
+
+	assert(index < rs->nr);
+
+	/* Fill the hole with the last one. @seqs keep the order they are added */
+	rs->nr--;
+	rs->processes[index] = rs->processes[rs->nr];
+	rs->keys[index] = rs->keys[rs->nr];
+	rs->seqs[index] = rs->seqs[rs->nr];
+
+	return p;
+}
+
+void ready_set_destroy(struct ready_set *rs)
+{
+	free(rs->processes);
+	free(rs->keys);
+	free(rs->seqs);
+	rs->processes = NULL;
+	rs->keys = NULL;
+	rs->seqs = NULL;
+	rs->nr = rs->size = rs->seq = 0;
+}
+
+
+/**
+ * Selection kernels. Each kernel finds the smallest (largest) key first and
+ * then the earliest added process holding the key, i.e., the one with the
+ * smallest sequence number, so that the tie is broken the same way regardless
+ * of the kernel.
+ */
+static unsigned int __select_scalar(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr, bool max)
+{
+	unsigned int selected = 0;
+
+	for (unsigned int i = 1; i < nr; i++) {
+		if (max ? keys[i] > keys[selected] : keys[i] < keys[selected]) {
+			selected = i;
+		} else if (keys[i] == keys[selected] && seqs[i] < seqs[selected]) {
+			selected = i;
+		}
+	}
+	return selected;
+}
+
+static unsigned int __argmin_scalar(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr)
+{
+	return __select_scalar(keys, seqs, nr, false);
+}
+
+static unsigned int __argmax_scalar(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr)
+{
+	return __select_scalar(keys, seqs, nr, true);
+}
+
+#ifdef CONFIG_SELECT_X86
+static inline __attribute__((always_inline, target("avx2")))
+unsigned int __select_avx2(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr, bool max)
+{
+	unsigned int lanes[8], indexes[8];
+	unsigned int i = 0;
+	unsigned int key = keys[0];
+	unsigned int seq = UINT_MAX, selected = 0;
+	__m256i v;
+
+	if (nr >= 8) {
+		v = _mm256_loadu_si256((const __m256i *)keys);
+		for (i = 8; i + 8 <= nr; i += 8) {
+			__m256i k = _mm256_loadu_si256((const __m256i *)(keys + i));
+			v = max ? _mm256_max_epu32(v, k) : _mm256_min_epu32(v, k);
+		}
+		_mm256_storeu_si256((__m256i *)lanes, v);
+		for (int j = 0; j < 8; j++) {
+			if (max ? lanes[j] > key : lanes[j] < key) key = lanes[j];
+		}
+	}
+	for (; i < nr; i++) {
+		if (max ? keys[i] > key : keys[i] < key) key = keys[i];
+	}
+
+	/* The smallest sequence number among the lanes holding the key */
+	i = 0;
+	if (nr >= 8) {
+		__m256i none = _mm256_set1_epi32(-1);
+		__m256i best = none, best_index = _mm256_setzero_si256();
+		__m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+		v = _mm256_set1_epi32(key);
+		for (; i + 8 <= nr; i += 8) {
+			__m256i k = _mm256_loadu_si256((const __m256i *)(keys + i));
+			__m256i s = _mm256_loadu_si256((const __m256i *)(seqs + i));
+			__m256i other = _mm256_andnot_si256(_mm256_cmpeq_epi32(k, v), none);
+			__m256i candidate = _mm256_or_si256(s, other);
+			__m256i less = _mm256_andnot_si256(
+					_mm256_cmpeq_epi32(_mm256_max_epu32(candidate, best), candidate), none);
+
+			best = _mm256_blendv_epi8(best, candidate, less);
+			best_index = _mm256_blendv_epi8(best_index, index, less);
+			index = _mm256_add_epi32(index, _mm256_set1_epi32(8));
+		}
+		_mm256_storeu_si256((__m256i *)lanes, best);
+		_mm256_storeu_si256((__m256i *)indexes, best_index);
+		for (int j = 0; j < 8; j++) {
+			if (lanes[j] < seq) {
+				seq = lanes[j];
+				selected = indexes[j];
+			}
+		}
+	}
+	for (; i < nr; i++) {
+		if (keys[i] == key && seqs[i] < seq) {
+			seq = seqs[i];
+			selected = i;
+		}
+	}
+	return selected;
+}
+
+static __attribute__((target("avx2")))
+unsigned int __argmin_avx2(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr)
+{
+	return __select_avx2(keys, seqs, nr, false);
+}
+
+static __attribute__((target("avx2")))
+unsigned int __argmax_avx2(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr)
+{
+	return __select_avx2(keys, seqs, nr, true);
+}
+
+static inline __attribute__((always_inline, target("sse4.1")))
+unsigned int __select_sse41(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr, bool max)
+{
+	unsigned int lanes[4], indexes[4];
+	unsigned int i = 0;
+	unsigned int key = keys[0];
+	unsigned int seq = UINT_MAX, selected = 0;
+	__m128i v;
+
+	if (nr >= 4) {
+		v = _mm_loadu_si128((const __m128i *)keys);
+		for (i = 4; i + 4 <= nr; i += 4) {
+			__m128i k = _mm_loadu_si128((const __m128i *)(keys + i));
+			v = max ? _mm_max_epu32(v, k) : _mm_min_epu32(v, k);
+		}
+		_mm_storeu_si128((__m128i *)lanes, v);
+		for (int j = 0; j < 4; j++) {
+			if (max ? lanes[j] > key : lanes[j] < key) key = lanes[j];
+		}
+	}
+	for (; i < nr; i++) {
+		if (max ? keys[i] > key : keys[i] < key) key = keys[i];
+	}
+
+	/* The smallest sequence number among the lanes holding the key */
+	i = 0;
+	if (nr >= 4) {
+		__m128i none = _mm_set1_epi32(-1);
+		__m128i best = none, best_index = _mm_setzero_si128();
+		__m128i index = _mm_setr_epi32(0, 1, 2, 3);
+
+		v = _mm_set1_epi32(key);
+		for (; i + 4 <= nr; i += 4) {
+			__m128i k = _mm_loadu_si128((const __m128i *)(keys + i));
+			__m128i s = _mm_loadu_si128((const __m128i *)(seqs + i));
+			__m128i other = _mm_andnot_si128(_mm_cmpeq_epi32(k, v), none);
+			__m128i candidate = _mm_or_si128(s, other);
+			__m128i less = _mm_andnot_si128(
+					_mm_cmpeq_epi32(_mm_max_epu32(candidate, best), candidate), none);
+
+			best = _mm_blendv_epi8(best, candidate, less);
+			best_index = _mm_blendv_epi8(best_index, index, less);
+			index = _mm_add_epi32(index, _mm_set1_epi32(4));
+		}
+		_mm_storeu_si128((__m128i *)lanes, best);
+		_mm_storeu_si128((__m128i *)indexes, best_index);
+		for (int j = 0; j < 4; j++) {
+			if (lanes[j] < seq) {
+				seq = lanes[j];
+				selected = indexes[j];
+			}
+		}
+	}
+	for (; i < nr; i++) {
+		if (keys[i] == key && seqs[i] < seq) {
+			seq = seqs[i];
+			selected = i;
+		}
+	}
+	return selected;
+}
+
+static __attribute__((target("sse4.1")))
+unsigned int __argmin_sse41(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr)
+{
+	return __select_sse41(keys, seqs, nr, false);
+}
+
+static __attribute__((target("sse4.1")))
+unsigned int __argmax_sse41(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr)
+{
+	return __select_sse41(keys, seqs, nr, true);
+}
+#endif
+
+static unsigned int __argmin_resolve(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr);
+static unsigned int __argmax_resolve(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr);
+
+static unsigned int (*__argmin)(const unsigned int *, const unsigned int *, unsigned int) =
+		__argmin_resolve;
+static unsigned int (*__argmax)(const unsigned int *, const unsigned int *, unsigned int) =
+		__argmax_resolve;
+
+/**
+ * Pick the kernels for the processor. Set READYSET_SCALAR in the environment
+ * to use the scalar kernels regardless of the processor
+ */
+static void __resolve_kernels(void)
+{
+	__argmin = __argmin_scalar;
+	__argmax = __argmax_scalar;
+
+	if (getenv("READYSET_SCALAR")) return;
+
+#ifdef CONFIG_SELECT_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		__argmin = __argmin_avx2;
+		__argmax = __argmax_avx2;
+	} else if (__builtin_cpu_supports("sse4.1")) {
+		__argmin = __argmin_sse41;
+		__argmax = __argmax_sse41;
+	}
+#endif
+}
+
+static unsigned int __argmin_resolve(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr)
+{
+	__resolve_kernels();
+	return __argmin(keys, seqs, nr);
+}
+
+static unsigned int __argmax_resolve(const unsigned int *keys, const unsigned int *seqs,
+		unsigned int nr)
+{
+	__resolve_kernels();
+	return __argmax(keys, seqs, nr);
+}
+
+unsigned int ready_set_argmin(struct ready_set *rs)
+{
+	assert(rs->nr);
+	return __argmin(rs->keys, rs->seqs, rs->nr);
+}
+
+unsigned int ready_set_argmax(struct ready_set *rs)
+{
+	assert(rs->nr);
+	return __argmax(rs->keys, rs->seqs, rs->nr);
+}
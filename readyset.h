@@ -0,0 +1,62 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __READYSET_H__
+#define __READYSET_H__
+
+struct process;
+
+/**
+ * Array-backed set of ready processes for the policies picking the process
+ * with the smallest or the largest key by scanning all the ready processes.
+ *
+ * The keys are kept in an array apart from the processes, so a pick scans a
+ * contiguous array with the vectorized kernels below instead of walking the
+ * processes node by node. A process removed out of the set is replaced by the
+ * last one in O(1), so the array is not in the order the processes are added.
+ * Instead, each process gets a sequence number (@seqs) when it is added, and
+ * the earliest added one wins a tie as the scan over the ready queue does. So,
+ * the key of a process must not change while it is in the set.
+ */
+struct ready_set {
+	struct process **processes;
+	unsigned int *keys;
+	unsigned int *seqs;
+	unsigned int nr;
+	unsigned int size;
+	unsigned int seq;		/* Sequence number for the next process */
+};
+
+#define READY_SET_INIT { NULL, NULL, NULL, 0, 0, 0 }
+
+void ready_set_add(struct ready_set *rs, struct process *p, unsigned int key);
+
+/**
+ * Remove the process at @index out of @rs and return it
+ */
+struct process *ready_set_del(struct ready_set *rs, unsigned int index);
+
+void ready_set_destroy(struct ready_set *rs);
+
+/**
+ * Return the index of the earliest added process among the ones with the
+ * smallest (largest) key. @rs should not be empty. The kernel is chosen for
+ * the processor the first time it is called; AVX2, SSE4.1, or the scalar one
+ * otherwise.
+ */
+unsigned int ready_set_argmin(struct ready_set *rs);
+unsigned int ready_set_argmax(struct ready_set *rs);
+
+#endif
@@ -0,0 +1,277 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "heap.h"
+
+#include "process.h"
+#include "resource.h"
+
+struct resource *resources = NULL;
+unsigned int nr_resources = 0;
+
+LIST_HEAD(active_resources);
+
+static unsigned int __nr_slots = 0;
+
+/**
+ * Hash index from resource IDs to the indexes in @resources
+ */
+struct resource_index {
+	unsigned int id;
+	int index;
+	struct hlist_node hash;
+};
+
+static struct hlist_head *__index = NULL;
+static unsigned int __nr_buckets = 0;
+
+static inline unsigned int __hash(unsigned int id)
+{
+	/* Multiplicative hashing to spread out sequential IDs */
+	return (id * 2654435761U) & (__nr_buckets - 1);
+}
+
+static void __grow_index(void)
+{
+	struct hlist_head *old = __index;
+	unsigned int nr_old = __nr_buckets;
+
+	__nr_buckets = __nr_buckets ? __nr_buckets * 2 : 64;
+	__index = malloc(sizeof(*__index) * __nr_buckets);
+	for (int i = 0; i < __nr_buckets; i++) {
+		INIT_HLIST_HEAD(__index + i);
+	}
+
+	for (int i = 0; i < nr_old; i++) {
+		struct hlist_node *pos, *n;
+		hlist_for_each_safe(pos, n, old + i) {
+			struct resource_index *ri = hlist_entry(pos, struct resource_index, hash);
+			hlist_del(pos);
+			hlist_add_head(pos, __index + __hash(ri->id));
+		}
+	}
+	free(old);
+}
+
+int get_resource(unsigned int id)
+{
+	struct resource_index *ri;
+
+	if (__nr_buckets) {
+		hlist_for_each_entry(ri, __index + __hash(id), hash) {
+			if (ri->id == id) return ri->index;
+		}
+	}
+
+	/* Not found. Add a new one */
+	if (nr_resources == __nr_slots) {
+		__nr_slots = __nr_slots ? __nr_slots * 2 : 32;
+		resources = realloc(resources, sizeof(*resources) * __nr_slots);
+	}
+	memset(resources + nr_resources, 0x00, sizeof(*resources));
+	resources[nr_resources].id = id;
+
+	/* Keep the load factor under 1 */
+	if (nr_resources >= __nr_buckets) __grow_index();
+
+	ri = malloc(sizeof(*ri));
+	ri->id = id;
+	ri->index = nr_resources;
+	hlist_add_head(&ri->hash, __index + __hash(id));
+
+	return nr_resources++;
+}
+
+void free_resources(void)
+{
+	struct resource *r, *tmp;
+
+	list_for_each_entry_safe(r, tmp, &active_resources, active) {
+		list_del_init(&r->active);
+	}
+	for (int i = 0; i < nr_resources; i++) {
+		free(resources[i].waiters.nodes);
+	}
+	free(resources);
+	resources = NULL;
+	nr_resources = __nr_slots = 0;
+
+	for (int i = 0; i < __nr_buckets; i++) {
+		struct hlist_node *pos, *n;
+		hlist_for_each_safe(pos, n, __index + i) {
+			hlist_del(pos);
+			free(hlist_entry(pos, struct resource_index, hash));
+		}
+	}
+	free(__index);
+	__index = NULL;
+	__nr_buckets = 0;
+}
+
+/**
+ * Arrival order of waiters to break ties among the waiters with the same
+ * priority in the FIFO way
+ */
+unsigned long __wait_seq = 0;
+
+static bool __waiter_less(struct heap_node *a, struct heap_node *b)
+{
+	struct process *pa = heap_entry(a, struct process, wait_node);
+	struct process *pb = heap_entry(b, struct process, wait_node);
+
+	if (pa->prio != pb->prio) return pa->prio > pb->prio;
+	return pa->wait_seq < pb->wait_seq;
+}
+
+void init_resource(struct resource *r)
+{
+	r->owner = NULL;
+	r->nr_holders = 0;
+	INIT_LIST_HEAD(&r->waitqueue);
+	INIT_HEAP(&r->waiters, __waiter_less);
+	INIT_HEAP_NODE(&r->donor_node);
+	r->ceiling = 0;
+	INIT_LIST_HEAD(&r->active);
+}
+
+bool resource_available(struct resource *r, struct process *p)
+{
+	switch (r->kind) {
+	case RESOURCE_SEMAPHORE:
+		return r->nr_holders < r->capacity;
+	case RESOURCE_RWLOCK:
+		if (p->acquire_shared) return !r->owner;
+		/* Fall through for the exclusive mode */
+	case RESOURCE_MUTEX:
+		return !r->nr_holders;
+	}
+	return false;
+}
+
+bool resource_take(struct resource *r, struct process *p)
+{
+	if (!resource_available(r, p)) return false;
+
+	if (r->kind == RESOURCE_MUTEX ||
+			(r->kind == RESOURCE_RWLOCK && !p->acquire_shared)) {
+		r->owner = p;
+	}
+	r->nr_holders++;
+	return true;
+}
+
+void resource_put(struct resource *r, struct process *p)
+{
+	assert(r->nr_holders);
+	assert(r->owner == p || (!r->owner && r->kind != RESOURCE_MUTEX));
+
+	r->owner = NULL;
+	r->nr_holders--;
+}
+
+#define WOKEN_EXCLUSIVE	(1U << 31)
+
+bool resource_wakeable(struct resource *r, struct process *p, unsigned int *woken)
+{
+	/* Nothing can come after a waiter that will hold the resource exclusively */
+	if (*woken & WOKEN_EXCLUSIVE) return false;
+
+	switch (r->kind) {
+	case RESOURCE_SEMAPHORE:
+		if (r->nr_holders + *woken >= r->capacity) return false;
+		(*woken)++;
+		return true;
+	case RESOURCE_RWLOCK:
+		if (p->acquire_shared) {
+			if (r->owner) return false;
+			(*woken)++;
+			return true;
+		}
+		/* Fall through for the exclusive mode */
+	case RESOURCE_MUTEX:
+		if (r->nr_holders || *woken) return false;
+		*woken |= WOKEN_EXCLUSIVE;
+		return true;
+	}
+	return false;
+}
+
+void activate_resource(struct resource *r)
+{
+	if (list_empty(&r->active)) {
+		list_add_tail(&r->active, &active_resources);
+	}
+}
+
+void deactivate_resource(struct resource *r)
+{
+	if (!r->nr_holders && list_empty(&r->waitqueue)) {
+		list_del_init(&r->active);
+	}
+}
+
+void resource_add_waiter(struct resource *r, struct process *p)
+{
+	list_add_tail(&p->list, &r->waitqueue);
+
+	p->wait_seq = __wait_seq++;
+	heap_push(&r->waiters, &p->wait_node);
+}
+
+void resource_del_waiter(struct resource *r, struct process *p)
+{
+	list_del_init(&p->list);
+	heap_del(&r->waiters, &p->wait_node);
+}
+
+void resource_update_waiter(struct resource *r, struct process *p)
+{
+	heap_update(&r->waiters, &p->wait_node);
+}
+
+struct process *resource_top_waiter(struct resource *r)
+{
+	return heap_top_entry_or_null(&r->waiters, struct process, wait_node);
+}
+
+void report_resources(void)
+{
+	for (int i = 0; i < nr_resources; i++) {
+		struct resource *r = resources + i;
+
+		if (!r->spin_ticks && !r->nr_timeouts) continue;
+
+		printf("- Resource %d:", r->id);
+		if (r->spin_ticks) {
+			printf(" spun %d ticks, acquired %d time%s while spinning, "
+					"blocked %d time%s after spinning%s",
+					r->spin_ticks,
+					r->nr_spin_acquired, r->nr_spin_acquired >= 2 ? "s" : "",
+					r->nr_spin_blocked, r->nr_spin_blocked >= 2 ? "s" : "",
+					r->nr_timeouts ? "," : "");
+		}
+		if (r->nr_timeouts) {
+			printf(" gave up %d time%s", r->nr_timeouts, r->nr_timeouts >= 2 ? "s" : "");
+		}
+		printf("\n");
+	}
+}
@@ -19,26 +19,182 @@
 struct process;
 struct list_head;
 
+/**
+ * Kinds of resources. A mutex is held by one process at a time. A semaphore
+ * is held by up to @capacity processes at the same time. A reader/writer lock
+ * is held either by one process in the exclusive mode or by any number of
+ * processes in the shared mode.
+ */
+enum resource_kind {
+	RESOURCE_MUTEX,
+	RESOURCE_SEMAPHORE,
+	RESOURCE_RWLOCK,
+};
+
 /**
  * Resources in the system.
  */
 struct resource {
+	/**
+	 * ID of the resource in the process description file
+	 */
+	unsigned int id;
+
+	enum resource_kind kind;
+	unsigned int capacity;	/* # of holders allowed for semaphores */
+
 	/**
 	 * The owner process of this resource. NULL implies the resource is free
-	 * whereas non-NULL implies @owner process owns this resource
+	 * whereas non-NULL implies @owner process owns this resource exclusively.
+	 * Semaphores and reader/writer locks held in the shared mode are not
+	 * owned by any process, but are held by @nr_holders processes.
 	 */
 	struct process *owner;
+	unsigned int nr_holders;
 
 	/**
 	 * list head to list processes that are wanting for the resource
 	 */
 	struct list_head waitqueue;
+
+	/**
+	 * The processes in @waitqueue ordered by their priority. The processes
+	 * with the same priority are ordered in their arrival order. Maintained
+	 * only by the policies using resource_add_waiter() and its friends
+	 */
+	struct heap waiters;
+
+	/**
+	 * For priority inheritance. @donor_prio is the highest priority among the
+	 * waiters, and the resource is in @owner->donors through @donor_node
+	 * while it is waited for by others
+	 */
+	unsigned int donor_prio;
+	struct heap_node donor_node;
+
+	/**
+	 * Priority ceiling of the resource, which is the highest initial priority
+	 * among the processes that are scripted to acquire the resource. Computed
+	 * when the processes are loaded
+	 */
+	unsigned int ceiling;
+
+	/**
+	 * # of ticks a process spins on the processor waiting for the resource
+	 * before it gets blocked. 0 to get blocked at once. An acquire may
+	 * override this with its own spin budget
+	 */
+	unsigned int spin;
+
+	/**
+	 * Spinning statistics. @spin_ticks is the processor ticks burnt by the
+	 * spinning processes, @nr_spin_acquired is the # of acquisitions made
+	 * while spinning, and @nr_spin_blocked is the # of processes blocked
+	 * after running out of the spin budget
+	 */
+	unsigned int spin_ticks;
+	unsigned int nr_spin_acquired;
+	unsigned int nr_spin_blocked;
+
+	/**
+	 * # of acquisitions given up by tryacquire or timed out
+	 */
+	unsigned int nr_timeouts;
+
+	/**
+	 * list head for @active_resources. Maintained by the framework
+	 */
+	struct list_head active;
 };
 
 /**
- * This system has 32 different resources. It is defined in pa2.c as an array of
- * struct resource (i.e., struct resource resources[NR_RESOURCES];)
+ * Resources in the system. The table is sized by the number of distinct
+ * resource IDs in the process description file, and the IDs are mapped to
+ * the indexes of the table through a hash index. The scheduler callbacks
+ * (acquire() and release()) get the index, so resources[resource_id] is the
+ * resource to acquire or release.
+ */
+extern struct resource *resources;
+extern unsigned int nr_resources;
+
+/**
+ * Resources which are owned or waited for
+ */
+extern struct list_head active_resources;
+
+/**
+ * Arrival order of the next waiter. Maintained by resource_add_waiter()
+ */
+extern unsigned long __wait_seq;
+
+/**
+ * Get the index of the resource with @id. Add the resource to the table if
+ * it is not there yet. The table may move while adding resources, so do not
+ * hold pointers to resources until all process descriptions are loaded
+ */
+int get_resource(unsigned int id);
+
+/**
+ * Free the resource table and its hash index at the end of the simulation
+ */
+void free_resources(void);
+
+void init_resource(struct resource *r);
+
+/**
+ * Check whether @p can take @r in the mode given by @p->acquire_shared
+ * without taking it
+ */
+bool resource_available(struct resource *r, struct process *p);
+
+/**
+ * Take @r for @p in the mode given by @p->acquire_shared. Return false
+ * if @r is not available in the mode
+ */
+bool resource_take(struct resource *r, struct process *p);
+
+/**
+ * Put @r held by @p
+ */
+void resource_put(struct resource *r, struct process *p);
+
+/**
+ * Check whether waiter @p can take @r on top of the waiters woken up so far.
+ * @woken keeps track of the woken-up waiters and should be 0 before checking
+ * the first waiter. Wake up the waiters in order while this returns true so
+ * that all compatible waiters are woken up at once
+ */
+bool resource_wakeable(struct resource *r, struct process *p, unsigned int *woken);
+
+/**
+ * Put @r on/off @active_resources as it is taken and released
+ */
+void activate_resource(struct resource *r);
+void deactivate_resource(struct resource *r);
+
+/**
+ * Append @p to the waitqueue of @r and put it in the priority order
+ */
+void resource_add_waiter(struct resource *r, struct process *p);
+
+/**
+ * Take @p out of the waitqueue of @r
+ */
+void resource_del_waiter(struct resource *r, struct process *p);
+
+/**
+ * Re-position @p in the priority order after its priority is changed
+ */
+void resource_update_waiter(struct resource *r, struct process *p);
+
+/**
+ * Get the waiter with the highest priority. NULL if no one is waiting
+ */
+struct process *resource_top_waiter(struct resource *r);
+
+/**
+ * Report the spinning and timeout statistics of the resources
  */
-#define NR_RESOURCES 32
+void report_resources(void);
 
 #endif
@@ -0,0 +1,209 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "heap.h"
+
+#include "process.h"
+#include "resource.h"
+#include "schedstat.h"
+#include "sampler.h"
+
+extern unsigned int ticks;
+
+unsigned int sample_interval = 0;
+
+/**
+ * The buffer keeps each column in its own array, so taking a sample appends
+ * a word to each column and the columns are written out as they are
+ */
+static struct {
+	unsigned int nr;
+	unsigned int size;
+
+	uint32_t *tick;
+	uint32_t *ready;
+	uint32_t *busy;
+	uint32_t *boosted;
+	uint32_t **blocked;		/* For each resource */
+	unsigned int nr_resources;
+
+	unsigned int idle_ticks;	/* Idle ticks at the last sample */
+	unsigned int last_tick;		/* The tick of the last sample */
+} __samples = {0};
+
+/* Do not allocate too much up front for a long simulation */
+#define SAMPLE_INITIAL_MAX	(1U << 20)
+
+static void __resize_samples(unsigned int size)
+{
+	__samples.size = size;
+	__samples.tick = realloc(__samples.tick, sizeof(uint32_t) * size);
+	__samples.ready = realloc(__samples.ready, sizeof(uint32_t) * size);
+	__samples.busy = realloc(__samples.busy, sizeof(uint32_t) * size);
+	__samples.boosted = realloc(__samples.boosted, sizeof(uint32_t) * size);
+	for (int i = 0; i < __samples.nr_resources; i++) {
+		__samples.blocked[i] = realloc(__samples.blocked[i], sizeof(uint32_t) * size);
+	}
+}
+
+void init_sampler(unsigned int nr_ticks)
+{
+	unsigned int size = nr_ticks / sample_interval + 1;
+
+	if (size > SAMPLE_INITIAL_MAX) size = SAMPLE_INITIAL_MAX;
+
+	__samples.nr_resources = nr_resources;
+	__samples.blocked = calloc(nr_resources, sizeof(*__samples.blocked));
+	__resize_samples(size);
+}
+
+void take_sample(unsigned int nr_unblocked)
+{
+	unsigned int i = __samples.nr;
+	unsigned int nr_blocked = 0;
+	unsigned int nr_boosted = 0;
+	unsigned int nr_ticks = i ? ticks - __samples.last_tick : ticks + 1;
+	struct resource *r;
+
+	if (i == __samples.size) __resize_samples(__samples.size * 2);
+
+	for (int j = 0; j < __samples.nr_resources; j++) {
+		__samples.blocked[j][i] = 0;
+	}
+
+	/**
+	 * Processes are blocked on and boosted by the resources being owned or
+	 * waited for only. A boosted owner runs at the priority donated by the
+	 * top of its @donors, so it is counted on that resource only once
+	 */
+	list_for_each_entry(r, &active_resources, active) {
+		struct process *p;
+		unsigned int nr = 0;
+
+		list_for_each_entry(p, &r->waitqueue, list) {
+			nr++;
+		}
+		__samples.blocked[r - resources][i] = nr;
+		nr_blocked += nr;
+
+		if (r->owner && r->owner->prio > r->owner->prio_orig &&
+				heap_top(&r->owner->donors) == &r->donor_node) {
+			nr_boosted++;
+		}
+	}
+
+	__samples.tick[i] = ticks;
+	__samples.ready[i] = nr_unblocked - nr_blocked;
+	__samples.busy[i] = nr_ticks - (schedstat.nr_idle_ticks - __samples.idle_ticks);
+	__samples.boosted[i] = nr_boosted;
+
+	__samples.idle_ticks = schedstat.nr_idle_ticks;
+	__samples.last_tick = ticks;
+	__samples.nr++;
+}
+
+static bool __has_suffix(const char *str, const char *suffix)
+{
+	size_t len = strlen(str);
+	size_t suffix_len = strlen(suffix);
+
+	return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
+
+static void __write_csv(FILE *file)
+{
+	fprintf(file, "tick,ready,busy,boosted");
+	for (int j = 0; j < __samples.nr_resources; j++) {
+		fprintf(file, ",blocked%u", resources[j].id);
+	}
+	fprintf(file, "\n");
+
+	for (int i = 0; i < __samples.nr; i++) {
+		fprintf(file, "%u,%u,%u,%u", __samples.tick[i], __samples.ready[i],
+				__samples.busy[i], __samples.boosted[i]);
+		for (int j = 0; j < __samples.nr_resources; j++) {
+			fprintf(file, ",%u", __samples.blocked[j][i]);
+		}
+		fprintf(file, "\n");
+	}
+}
+
+static void __write_binary(FILE *file)
+{
+	struct sample_header header = {
+		.magic = SAMPLE_MAGIC,
+		.version = SAMPLE_VERSION,
+		.interval = sample_interval,
+		.nr_samples = __samples.nr,
+		.nr_resources = __samples.nr_resources,
+	};
+
+	fwrite(&header, sizeof(header), 1, file);
+	for (int j = 0; j < __samples.nr_resources; j++) {
+		uint32_t id = resources[j].id;
+		fwrite(&id, sizeof(id), 1, file);
+	}
+
+	fwrite(__samples.tick, sizeof(uint32_t), __samples.nr, file);
+	fwrite(__samples.ready, sizeof(uint32_t), __samples.nr, file);
+	fwrite(__samples.busy, sizeof(uint32_t), __samples.nr, file);
+	fwrite(__samples.boosted, sizeof(uint32_t), __samples.nr, file);
+	for (int j = 0; j < __samples.nr_resources; j++) {
+		fwrite(__samples.blocked[j], sizeof(uint32_t), __samples.nr, file);
+	}
+}
+
+bool write_samples(const char *filename)
+{
+	FILE *file = fopen(filename, "w");
+	bool ret = true;
+
+	if (!file) {
+		fprintf(stderr, "Unable to open %s: %s\n", filename, strerror(errno));
+		ret = false;
+		goto out;
+	}
+
+	if (__has_suffix(filename, ".bin")) {
+		__write_binary(file);
+	} else {
+		__write_csv(file);
+	}
+
+	if (fclose(file)) {
+		fprintf(stderr, "Unable to write %s: %s\n", filename, strerror(errno));
+		ret = false;
+	}
+
+out:
+	free(__samples.tick);
+	free(__samples.ready);
+	free(__samples.busy);
+	free(__samples.boosted);
+	for (int j = 0; j < __samples.nr_resources; j++) {
+		free(__samples.blocked[j]);
+	}
+	free(__samples.blocked);
+	memset(&__samples, 0x00, sizeof(__samples));
+
+	return ret;
+}
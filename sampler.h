@@ -0,0 +1,72 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+#include <stdint.h>
+
+/**
+ * Time series of the system state. With -k @ticks, the framework samples the
+ * state every @ticks ticks into a columnar buffer, and writes the buffer into
+ * the file given by -o at the end of the simulation. Each sample has
+ *
+ *   tick      the tick when the sample is taken
+ *   ready     # of processes ready to run
+ *   busy      # of ticks the processor ran a process since the last sample
+ *   boosted   # of processes running at a priority above their own
+ *   blocked   # of processes waiting for each resource
+ *
+ * Sampling looks into the resources being owned or waited for only, so it
+ * costs little even when taken frequently. The buffer is sized for the
+ * expected length of the simulation up front, and grows when it runs out.
+ *
+ * The file is in CSV with a header line unless its name ends with ".bin".
+ * The binary file starts with struct sample_header, followed by the resource
+ * IDs (@nr_resources uint32_t's) and the columns of @nr_samples uint32_t's
+ * each in the order of tick, ready, busy, boosted, and blocked for each
+ * resource. All numbers are in the host byte order.
+ */
+#define SAMPLE_MAGIC	0x53504d53	/* "SMPS" */
+#define SAMPLE_VERSION	1
+
+struct sample_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t interval;
+	uint32_t nr_samples;
+	uint32_t nr_resources;
+};
+
+extern unsigned int sample_interval;
+
+/**
+ * Prepare the buffer for a simulation running about @nr_ticks ticks
+ */
+void init_sampler(unsigned int nr_ticks);
+
+/**
+ * Take a sample at the current tick. @nr_unblocked is the # of processes
+ * alive but neither running, performing I/O, nor parked. The ones waiting
+ * for resources are counted off from it by the sampler
+ */
+void take_sample(unsigned int nr_unblocked);
+
+/**
+ * Write the samples into @filename and release the buffer
+ */
+bool write_samples(const char *filename);
+
+#endif
@@ -25,10 +25,18 @@
 
 #include "types.h"
 #include "list_head.h"
+#include "heap.h"
 
 #include "parser.h"
 #include "process.h"
 #include "resource.h"
+#include "timer.h"
+#include "group.h"
+#include "instrument.h"
+#include "schedstat.h"
+#include "sampler.h"
+#include "snapshot.h"
+#include "checkpoint.h"
 
 #include "sched.h"
 
@@ -47,11 +55,6 @@ struct process *current = NULL;
  */
 unsigned int ticks = 0;
 
-/**
- * Resources in the system.
- */
-struct resource resources[NR_RESOURCES];
-
 /**
  * Following code is to maintain the simulator itself.
  */
@@ -59,10 +62,138 @@ struct resource_schedule {
 	int resource_id;
 	int at;
 	int duration;
+	bool shared;
+	int spin;	/* Spin budget overriding the resource's. -1 if not given */
+	int spun;
+	bool blocked;
+
+	int timeout;	/* Ticks to wait before giving up. -1 to wait forever */
+	bool retry;		/* Retry after timing out instead of giving up */
+	unsigned int deadline;
+	struct timer timer;
+	struct process *process;
+
+	struct list_head list;
+};
+
+struct io_schedule {
+	int at;
+	int duration;
+	struct timer timer;
+	struct process *process;
+	struct list_head list;
+};
+
+/**
+ * Dependency on a predecessor process given by the @after property. Resolved
+ * to @__successors of the predecessor after all processes are loaded
+ */
+struct dependency {
+	unsigned int pid;			/* PID of the predecessor */
+	struct process *process;	/* The process to fork after the predecessor */
 	struct list_head list;
 };
 
+/**
+ * Program of a process. A process with a program runs it instead of the
+ * scripted acquisitions and I/O. The program is interpreted every time the
+ * process runs, and it is resumed from where it was left (@pc) the next time.
+ * Loops are unrolled on the fly by keeping the iterations left in @loops.
+ */
+enum program_op {
+	OP_COMPUTE,			/* Run @arg ticks */
+	OP_ACQUIRE,			/* Acquire resource @arg */
+	OP_ACQUIRE_SHARED,	/* Acquire resource @arg in the shared mode */
+	OP_RELEASE,			/* Release resource @arg */
+	OP_IO,				/* Perform I/O (or sleep) for @arg ticks */
+	OP_LOOP,			/* Run the following up to OP_ENDLOOP @arg times */
+	OP_ENDLOOP,
+	OP_FORK,			/* Fork process @arg */
+};
+
+struct instruction {
+	enum program_op op;
+	unsigned int arg;
+	int target;				/* Where to jump from OP_LOOP and OP_ENDLOOP */
+	struct process *child;	/* Process to fork. Resolved after loading */
+};
+
+struct program {
+	struct instruction *code;
+	int nr_code;
+	int nr_slots;
+
+	int pc;					/* Instruction to run next */
+	unsigned int left;		/* Ticks left in the current OP_COMPUTE */
+
+	unsigned int *loops;	/* Iterations left in the loops being run. While
+							   loading, the loops being open instead */
+	int depth;
+	int max_depth;
+};
+
 static LIST_HEAD(__forkqueue);
+static LIST_HEAD(__dependencies);
+
+/**
+ * Checkpoints refer to processes with their index into the process table
+ * (@__index), given in the order they are loaded. A process is freed when it
+ * exits, leaving its slot in the table NULL, so walks over the table should
+ * skip NULL slots.
+ */
+static struct process **__process_table = NULL;
+static unsigned int __nr_processes = 0;
+
+static inline struct process *__process_at(unsigned int index)
+{
+	return __process_table[index];
+}
+
+static struct process *__alloc_process(void)
+{
+	struct process *p = malloc(sizeof(*p));
+
+	/* Double the table whenever it is full */
+	if (!(__nr_processes & (__nr_processes - 1))) {
+		__process_table = realloc(__process_table,
+				sizeof(*__process_table) * (__nr_processes ? __nr_processes * 2 : 1));
+	}
+
+	memset(p, 0x00, sizeof(*p));
+	p->__index = __nr_processes;
+	__process_table[__nr_processes++] = p;
+
+	return p;
+}
+
+static void __free_processes(void)
+{
+	for (int i = 0; i < __nr_processes; i++) {
+		free(__process_table[i]);
+	}
+	free(__process_table);
+}
+
+/**
+ * To report the processor utilization when processes perform I/O
+ */
+static bool __io_scripted = false;
+
+/**
+ * For the scheduling statistics. The policies may keep the ready processes
+ * in their own structures, so the ready-queue length is derived from the
+ * number of processes alive less the ones running, waiting for resources,
+ * performing I/O, and parked
+ */
+static bool __schedstat = false;
+static unsigned int __nr_alive = 0;
+static unsigned int __nr_waiting = 0;
+static unsigned int __nr_io = 0;
+
+/**
+ * To report the makespan when processes depend on others
+ */
+static bool __dag_scripted = false;
 
 bool quiet = false;
 
@@ -71,53 +202,79 @@ static const char * __process_status_sz[] = {
 	"RUN",
 	"WAT",
 	"EXT",
+	"THR",
+	"IO ",
 };
 
 /**
  * Assorted schedulers
  */
-extern struct scheduler fifo_scheduler;
-extern struct scheduler sjf_scheduler;
-extern struct scheduler srtf_scheduler;
-extern struct scheduler rr_scheduler;
-extern struct scheduler prio_scheduler;
-extern struct scheduler pip_scheduler;
+extern const struct scheduler fifo_scheduler;
+extern const struct scheduler sjf_scheduler;
+extern const struct scheduler srtf_scheduler;
+extern const struct scheduler psjf_scheduler;
+extern const struct scheduler psrtf_scheduler;
+extern const struct scheduler rr_scheduler;
+extern const struct scheduler prio_scheduler;
+extern const struct scheduler pip_scheduler;
+extern const struct scheduler cbs_scheduler;
+extern const struct scheduler hfs_scheduler;
+extern const struct scheduler pcp_scheduler;
+extern const struct scheduler cp_scheduler;
+
+static const struct scheduler *sched = &fifo_scheduler;
+
+/**
+ * The functions in the simulation loop take the scheduler as the argument
+ * @sched, and are always inlined into the loop. So, the loop can be built for
+ * each scheduler with its callbacks known at compile time. See __simulate()
+ */
+#ifndef __always_inline
+#define __always_inline	inline __attribute__((always_inline))
+#endif
+
+void for_each_ready_process(void (*fn)(struct process *))
+{
+	struct process *p;
+
+	if (sched->for_each_ready) sched->for_each_ready(fn);
+
+	list_for_each_entry(p, &readyqueue, list) {
+		fn(p);
+	}
+}
 
-static struct scheduler *sched = &fifo_scheduler;
+static void __dump_process(struct process *p)
+{
+	printf("%2d (%s): %d + %d/%d at %d\n",
+			p->pid, __process_status_sz[p->status],
+			p->__starts_at, p->age, p->lifespan, p->prio);
+}
 
 void dump_status(void)
 {
 	struct process *p;
+	struct resource *r;
 
 	printf("***** CURRENT *********\n");
-	if (current) {
-		printf("%2d (%s): %d + %d/%d at %d\n",
-				current->pid, __process_status_sz[current->status],
-				current->__starts_at,
-				current->age, current->lifespan, current->prio);
-	}
+	if (current) __dump_process(current);
 
 	printf("***** READY QUEUE *****\n");
-	list_for_each_entry(p, &readyqueue, list) {
-		printf("%2d (%s): %d + %d/%d at %d\n",
-				p->pid, __process_status_sz[p->status],
-				p->__starts_at, p->age, p->lifespan, p->prio);
-	}
+	for_each_ready_process(__dump_process);
 
 	printf("***** RESOURCES *******\n");
-	for (int i = 0; i < NR_RESOURCES; i++) {
-		struct resource *r = resources + i;;
-		if (r->owner || !list_empty(&r->waitqueue)) {
-			printf("%2d: owned by ", i);
-			if (r->owner) {
-				printf("%d\n", r->owner->pid);
-			} else {
-				printf("no one\n");
-			}
+	list_for_each_entry(r, &active_resources, active) {
+		printf("%2d: owned by ", r->id);
+		if (r->owner) {
+			printf("%d\n", r->owner->pid);
+		} else if (r->nr_holders) {
+			printf("%d sharer%s\n", r->nr_holders, r->nr_holders >= 2 ? "s" : "");
+		} else {
+			printf("no one\n");
+		}
 
-			list_for_each_entry(p, &r->waitqueue, list) {
-				printf("    %d is waiting\n", p->pid);
-			}
+		list_for_each_entry(p, &r->waitqueue, list) {
+			printf("    %d is waiting\n", p->pid);
 		}
 	}
 	printf("\n\n");
@@ -126,11 +283,7 @@ void dump_status(void)
 }
 
 #define __print_event(pid, string, args...) do { \
-	fprintf(stderr, "%3d: ", ticks); \
-	for (int i = 0; i < pid; i++) { \
-		fprintf(stderr, "    "); \
-	} \
-	fprintf(stderr, string "\n", ##args); \
+	fprintf(stderr, "%3d: %*s" string "\n", ticks, (int)(pid) * 4, "", ##args); \
 } while (0);
 
 static inline bool strmatch(char * const str, const char *expect)
@@ -141,6 +294,8 @@ static inline bool strmatch(char * const str, const char *expect)
 static void __briefing_process(struct process *p)
 {
 	struct resource_schedule *rs;
+	struct io_schedule *io;
+	struct dependency *dep, *first = NULL;
 
 	if (quiet) return;
 
@@ -148,15 +303,257 @@ static void __briefing_process(struct process *p)
 				p->pid, p->__starts_at, p->lifespan,
 				p->lifespan >= 2 ? "s" : "", p->prio);
 
+	if (p->budget) {
+		printf("    Reserve %d tick%s every %d ticks\n",
+				p->budget, p->budget >= 2 ? "s" : "", p->period);
+	}
+
+	if (p->group) {
+		printf("    Belong to group %s\n", p->group->name);
+	}
+
 	list_for_each_entry(rs, &p->__resources_to_acquire, list) {
-		printf("    Acquire resource %d at %d for %d\n", rs->resource_id, rs->at, rs->duration);
+		printf("    %s resource %d at %d for %d%s",
+				rs->timeout == 0 ? "Try to acquire" : "Acquire",
+				resources[rs->resource_id].id, rs->at, rs->duration,
+				rs->shared ? " in shared mode" : "");
+		if (rs->timeout > 0) {
+			printf(" within %d tick%s%s", rs->timeout, rs->timeout >= 2 ? "s" : "",
+					rs->retry ? " and retry" : "");
+		}
+		if (rs->spin > 0) {
+			printf(" spinning up to %d tick%s", rs->spin, rs->spin >= 2 ? "s" : "");
+		}
+		printf("\n");
+	}
+
+	list_for_each_entry(io, &p->__io_to_perform, list) {
+		printf("    Perform I/O at %d for %d tick%s\n",
+				io->at, io->duration, io->duration >= 2 ? "s" : "");
+	}
+
+	/* The dependencies of @p have just been added at the tail of the list */
+	list_for_each_entry_reverse(dep, &__dependencies, list) {
+		if (dep->process != p) break;
+		first = dep;
+	}
+	if (first) {
+		dep = first;
+		printf("    Fork after process %d", dep->pid);
+		list_for_each_entry_continue(dep, &__dependencies, list) {
+			printf(", %d", dep->pid);
+		}
+		printf("\n");
+	}
+
+	if (p->__program) {
+		printf("    Run a program of %d instruction%s\n",
+				p->__program->nr_code, p->__program->nr_code >= 2 ? "s" : "");
+	}
+}
+
+static void __acquire_timeout(struct timer *timer);
+static void __complete_io(struct timer *timer);
+
+static struct resource_schedule *__alloc_resource_schedule(struct process *p, int resource_id)
+{
+	struct resource_schedule *rs = malloc(sizeof(*rs));
+
+	rs->resource_id = resource_id;
+	rs->at = 0;
+	rs->duration = 0;
+	rs->shared = false;
+	rs->spin = -1;
+	rs->spun = 0;
+	rs->blocked = false;
+	rs->timeout = -1;
+	rs->retry = false;
+	init_timer(&rs->timer, __acquire_timeout);
+	rs->process = p;
+
+	return rs;
+}
+
+/**
+ * Append an instruction to the program of @p. The lifespan of @p is the sum
+ * of the ticks to compute, which is multiplied by the enclosing loops
+ */
+static bool __load_instruction(struct process *p, int nr_tokens, char * const tokens[])
+{
+	struct program *prog = p->__program;
+	struct instruction *inst;
+
+	if (prog->nr_code == prog->nr_slots) {
+		prog->nr_slots = prog->nr_slots ? prog->nr_slots * 2 : 16;
+		prog->code = realloc(prog->code, sizeof(*prog->code) * prog->nr_slots);
+	}
+	inst = prog->code + prog->nr_code;
+	memset(inst, 0x00, sizeof(*inst));
+
+	if (strmatch(tokens[0], "endloop") && nr_tokens == 1) {
+		int loop;
+
+		if (!prog->depth) {
+			fprintf(stderr, "endloop without loop in process %d\n", p->pid);
+			return false;
+		}
+		loop = prog->loops[--prog->depth];
+
+		inst->op = OP_ENDLOOP;
+		inst->target = loop + 1;
+		prog->code[loop].target = prog->nr_code + 1;
+		prog->nr_code++;
+		return true;
+	}
+
+	if (nr_tokens != 2) {
+		fprintf(stderr, "Invalid instruction %s in process %d\n", tokens[0], p->pid);
+		return false;
+	}
+	inst->arg = atoi(tokens[1]);
+
+	if (strmatch(tokens[0], "compute")) {
+		unsigned int ticks = inst->arg;
+
+		if (!ticks) return true;
+
+		for (int i = 0; i < prog->depth; i++) {
+			ticks *= prog->code[prog->loops[i]].arg;
+		}
+		p->lifespan += ticks;
+		inst->op = OP_COMPUTE;
+	} else if (strmatch(tokens[0], "acquire")) {
+		inst->op = OP_ACQUIRE;
+		inst->arg = get_resource(inst->arg);
+	} else if (strmatch(tokens[0], "acquire-shared")) {
+		inst->op = OP_ACQUIRE_SHARED;
+		inst->arg = get_resource(inst->arg);
+	} else if (strmatch(tokens[0], "release")) {
+		inst->op = OP_RELEASE;
+		inst->arg = get_resource(inst->arg);
+	} else if (strmatch(tokens[0], "io") || strmatch(tokens[0], "sleep")) {
+		if (!inst->arg) return true;
+		inst->op = OP_IO;
+		__io_scripted = true;
+	} else if (strmatch(tokens[0], "loop")) {
+		inst->op = OP_LOOP;
+
+		if (prog->depth == prog->max_depth) {
+			prog->max_depth = prog->max_depth ? prog->max_depth * 2 : 4;
+			prog->loops = realloc(prog->loops, sizeof(*prog->loops) * prog->max_depth);
+		}
+		prog->loops[prog->depth++] = prog->nr_code;
+	} else if (strmatch(tokens[0], "fork")) {
+		if (prog->depth) {
+			fprintf(stderr, "Process %d forks process %d in a loop\n", p->pid, inst->arg);
+			return false;
+		}
+		inst->op = OP_FORK;
+	} else {
+		fprintf(stderr, "Unknown instruction %s in process %d\n", tokens[0], p->pid);
+		return false;
+	}
+
+	prog->nr_code++;
+	return true;
+}
+
+/**
+ * Check how @code[from, to) ends. Return 1 if it ends with computing, -1 if
+ * it ends with an instruction that should be followed by computing (i.e.,
+ * acquisition and I/O), and 0 if it has neither
+ */
+static int __program_tail(struct program *prog, int from, int to)
+{
+	for (int i = to - 1; i >= from; i--) {
+		struct instruction *inst = prog->code + i;
+		int loop, ret;
+
+		switch (inst->op) {
+		case OP_COMPUTE:
+			return 1;
+		case OP_ACQUIRE:
+		case OP_ACQUIRE_SHARED:
+		case OP_IO:
+			return -1;
+		case OP_ENDLOOP:
+			loop = inst->target - 1;
+			ret = prog->code[loop].arg ? __program_tail(prog, loop + 1, i) : 0;
+			if (ret) return ret;
+			i = loop;
+			break;
+		default:
+			break;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Check that the program of @p releases only the resources it holds, that
+ * every iteration of a loop holds the same resources, and that the program
+ * releases all the resources before it ends. @held keeps the number of holds
+ * of each resource at each loop level
+ */
+static bool __program_balanced(struct process *p)
+{
+	struct program *prog = p->__program;
+	int *held = calloc(nr_resources * (prog->max_depth + 1) + 1, sizeof(*held));
+	int *now = held;
+	bool ret = false;
+
+	for (int i = 0; i < prog->nr_code; i++) {
+		struct instruction *inst = prog->code + i;
+
+		switch (inst->op) {
+		case OP_ACQUIRE:
+		case OP_ACQUIRE_SHARED:
+			now[inst->arg]++;
+			break;
+		case OP_RELEASE:
+			if (!now[inst->arg]) {
+				fprintf(stderr, "Process %d releases resource %d not held\n",
+						p->pid, resources[inst->arg].id);
+				goto out;
+			}
+			now[inst->arg]--;
+			break;
+		case OP_LOOP:
+			memcpy(now + nr_resources, now, sizeof(*now) * nr_resources);
+			now += nr_resources;
+			break;
+		case OP_ENDLOOP:
+			if (memcmp(now - nr_resources, now, sizeof(*now) * nr_resources)) {
+				fprintf(stderr, "Process %d holds different resources "
+						"over iterations of a loop\n", p->pid);
+				goto out;
+			}
+			now -= nr_resources;
+			break;
+		default:
+			break;
+		}
 	}
+
+	for (int i = 0; i < nr_resources; i++) {
+		if (held[i]) {
+			fprintf(stderr, "Process %d ends holding resource %d\n",
+					p->pid, resources[i].id);
+			goto out;
+		}
+	}
+	ret = true;
+
+out:
+	free(held);
+	return ret;
 }
 
 static int __load_script(char * const filename)
 {
 	char line[256];
 	struct process *p = NULL;
+	bool program = false;
 
 	FILE *file = fopen(filename, "r");
 	while (fgets(line, sizeof(line), file)) {
@@ -167,24 +564,138 @@ static int __load_script(char * const filename)
 
 		if (nr_tokens == 0) continue;
 
+		if (strmatch(tokens[0], "quota")) {
+			struct group *g;
+			assert(nr_tokens == 4);
+			assert(!p && "quota should be given out of process description");
+
+			g = get_group(tokens[1]);
+			g->quota = atoi(tokens[2]);
+			g->period = atoi(tokens[3]);
+
+			if (!g->period || g->quota > g->period) {
+				fprintf(stderr, "Invalid quota %d/%d for group %s\n",
+						g->quota, g->period, g->name);
+				return false;
+			}
+			continue;
+		} else if (strmatch(tokens[0], "resource")) {
+			struct resource *r;
+			int index;
+			int i = 3;
+			assert(nr_tokens >= 3);
+			assert(!p && "resource should be given out of process description");
+
+			/* @resources may move while getting the index. Look up it first */
+			index = get_resource(atoi(tokens[1]));
+			r = resources + index;
+			if (strmatch(tokens[2], "mutex")) {
+				r->kind = RESOURCE_MUTEX;
+			} else if (strmatch(tokens[2], "semaphore")) {
+				if (nr_tokens < 4) {
+					fprintf(stderr, "Missing capacity for semaphore %d\n", r->id);
+					return false;
+				}
+				if (atoi(tokens[i]) < 1) {
+					fprintf(stderr, "Invalid capacity %s for semaphore %d\n",
+							tokens[i], r->id);
+					return false;
+				}
+				r->kind = RESOURCE_SEMAPHORE;
+				r->capacity = atoi(tokens[i++]);
+			} else if (strmatch(tokens[2], "rwlock")) {
+				r->kind = RESOURCE_RWLOCK;
+			} else {
+				fprintf(stderr, "Invalid resource kind %s\n", tokens[2]);
+				return false;
+			}
+
+			if (i < nr_tokens) {
+				if (nr_tokens != i + 2 || !strmatch(tokens[i], "spin")) {
+					fprintf(stderr, "Invalid option %s for resource %d\n",
+							tokens[i], r->id);
+					return false;
+				}
+				r->spin = atoi(tokens[i + 1]);
+			}
+			continue;
+		} else if (strmatch(tokens[0], "weight")) {
+			struct group *g;
+			assert(nr_tokens == 3);
+			assert(!p && "weight should be given out of process description");
+
+			g = get_group(tokens[1]);
+			g->weight = atoi(tokens[2]);
+
+			if (!g->weight) {
+				fprintf(stderr, "Invalid weight for group %s\n", g->name);
+				return false;
+			}
+			continue;
+		}
+
 		if (strmatch(tokens[0], "process")) {
 			assert(nr_tokens == 2);
 			/* Start processor description */
-			p = malloc(sizeof(*p));
-			memset(p, 0x00, sizeof(*p));
+			p = __alloc_process();
 
 			p->pid = atoi(tokens[1]);
 
 			INIT_LIST_HEAD(&p->list);
 			INIT_LIST_HEAD(&p->__resources_to_acquire);
 			INIT_LIST_HEAD(&p->__resources_holding);
+			INIT_LIST_HEAD(&p->__io_to_perform);
+			INIT_HEAP_NODE(&p->wait_node);
 
 			continue;
 		} else if (strmatch(tokens[0], "end")) {
 			/* End of process description */
-			struct resource_schedule *rs;
+			struct io_schedule *io;
 			assert(p);
 
+			if (program) {
+				if (p->__program->depth) {
+					fprintf(stderr, "loop without endloop in process %d\n", p->pid);
+					return false;
+				}
+				if (!p->lifespan) {
+					fprintf(stderr, "Program of process %d does not compute\n", p->pid);
+					return false;
+				}
+				if (__program_tail(p->__program, 0, p->__program->nr_code) < 0) {
+					fprintf(stderr, "Program of process %d should end with "
+							"compute, release, or fork\n", p->pid);
+					return false;
+				}
+				if (!__program_balanced(p)) return false;
+				program = false;
+			}
+
+			if (!!p->budget != !!p->period || p->budget > p->period) {
+				fprintf(stderr, "Invalid reservation %d/%d for process %d\n",
+						p->budget, p->period, p->pid);
+				return false;
+			}
+
+			/* I/O should be performed between CPU bursts, one at a time */
+			list_for_each_entry(io, &p->__io_to_perform, list) {
+				struct io_schedule *prev;
+
+				if (io->at <= 0 || io->at >= p->lifespan || io->duration <= 0) {
+					fprintf(stderr, "Invalid I/O at %d for %d for process %d\n",
+							io->at, io->duration, p->pid);
+					return false;
+				}
+				list_for_each_entry(prev, &p->__io_to_perform, list) {
+					if (prev == io) break;
+					if (prev->at == io->at) {
+						fprintf(stderr, "Process %d performs I/O twice at %d\n",
+								p->pid, io->at);
+						return false;
+					}
+				}
+			}
+
 			list_add_tail(&p->list, &__forkqueue);
 
 			__briefing_process(p);
@@ -193,7 +704,22 @@ static int __load_script(char * const filename)
 			continue;
 		}
 
-		if (strmatch(tokens[0], "lifespan")) {
+		if (program) {
+			if (!__load_instruction(p, nr_tokens, tokens)) return false;
+		} else if (strmatch(tokens[0], "program")) {
+			assert(nr_tokens == 1);
+
+			if (p->lifespan || !list_empty(&p->__resources_to_acquire) ||
+					!list_empty(&p->__io_to_perform)) {
+				fprintf(stderr, "Process %d has both a program and "
+						"lifespan, acquire, or io\n", p->pid);
+				return false;
+			}
+
+			p->__program = malloc(sizeof(*p->__program));
+			memset(p->__program, 0x00, sizeof(*p->__program));
+			program = true;
+		} else if (strmatch(tokens[0], "lifespan")) {
 			assert(nr_tokens == 2);
 			p->lifespan = atoi(tokens[1]);
 		} else if (strmatch(tokens[0], "prio")) {
@@ -202,133 +728,1288 @@ static int __load_script(char * const filename)
 		} else if (strmatch(tokens[0], "start")) {
 			assert(nr_tokens == 2);
 			p->__starts_at = atoi(tokens[1]);
-		} else if (strmatch(tokens[0], "acquire")) {
+		} else if (strmatch(tokens[0], "group")) {
+			assert(nr_tokens == 2);
+			p->group = get_group(tokens[1]);
+		} else if (strmatch(tokens[0], "budget")) {
+			assert(nr_tokens == 2);
+			p->budget = atoi(tokens[1]);
+		} else if (strmatch(tokens[0], "period")) {
+			assert(nr_tokens == 2);
+			p->period = atoi(tokens[1]);
+		} else if (strmatch(tokens[0], "acquire") ||
+				strmatch(tokens[0], "acquire-shared") ||
+				strmatch(tokens[0], "tryacquire") ||
+				strmatch(tokens[0], "acquire-timeout")) {
+			struct resource_schedule *rs;
+
+			rs = __alloc_resource_schedule(p, get_resource(atoi(tokens[1])));
+
+			rs->at = atoi(tokens[2]);
+			rs->duration = atoi(tokens[3]);
+			rs->shared = strmatch(tokens[0], "acquire-shared");
+
+			if (strmatch(tokens[0], "tryacquire")) {
+				assert(nr_tokens == 4);
+				rs->timeout = 0;
+				rs->spin = 0;
+			} else if (strmatch(tokens[0], "acquire-timeout")) {
+				assert(nr_tokens == 5 ||
+						(nr_tokens == 6 && strmatch(tokens[5], "retry")));
+				rs->timeout = atoi(tokens[4]);
+				rs->retry = nr_tokens == 6;
+
+				if (rs->timeout <= 0) {
+					fprintf(stderr, "Invalid timeout %d for process %d\n",
+							rs->timeout, p->pid);
+					return false;
+				}
+			} else {
+				assert(nr_tokens == 4 ||
+						(nr_tokens == 6 && strmatch(tokens[4], "spin")));
+				if (nr_tokens == 6) rs->spin = atoi(tokens[5]);
+			}
+
+			list_add_tail(&rs->list, &p->__resources_to_acquire);
+		} else if (strmatch(tokens[0], "after")) {
+			assert(nr_tokens >= 2);
+
+			for (int i = 1; i < nr_tokens; i++) {
+				struct dependency *dep = malloc(sizeof(*dep));
+
+				dep->pid = atoi(tokens[i]);
+				dep->process = p;
+				list_add_tail(&dep->list, &__dependencies);
+			}
+			__dag_scripted = true;
+		} else if (strmatch(tokens[0], "io")) {
+			struct io_schedule *io;
+			assert(nr_tokens == 3);
+
+			io = malloc(sizeof(*io));
+
+			io->at = atoi(tokens[1]);
+			io->duration = atoi(tokens[2]);
+			init_timer(&io->timer, __complete_io);
+			io->process = p;
+
+			list_add_tail(&io->list, &p->__io_to_perform);
+			__io_scripted = true;
+		} else {
+			fprintf(stderr, "Unknown property %s\n", tokens[0]);
+			return false;
+		}
+	}
+	fclose(file);
+	if (!quiet) printf("\n");
+	return true;
+}
+
+
+/**
+ * Fork process on schedule
+ */
+static __always_inline int __fork_on_schedule(const struct scheduler *sched)
+{
+	int nr_forked = 0;
+	struct process *p, *tmp;
+	list_for_each_entry_safe(p, tmp, &__forkqueue, list) {
+		if (p->__starts_at <= ticks && !p->__nr_waiting_for) {
+			list_move_tail(&p->list, &readyqueue);
+			p->status = PROCESS_READY;
+			p->__forked = true;
+			__print_event(p->pid, "N");
+			if (sched->forked) instrument(INSTRUMENT_FORKED, sched->forked(p));
+			if (process_throttled(p)) park_process(p);
+			__nr_alive++;
+			nr_forked++;
+		}
+	}
+	return nr_forked;
+}
+
+/**
+ * Free what is loaded from the script for @p, which is not needed after exit
+ */
+static void __release_process(struct process *p)
+{
+	free(p->__successors);
+
+	if (p->__program) {
+		free(p->__program->code);
+		free(p->__program->loops);
+		free(p->__program);
+	}
+}
+
+/**
+ * Free @p altogether when it exits
+ */
+static void __free_process(struct process *p)
+{
+	__release_process(p);
+
+	__process_table[p->__index] = NULL;
+	free(p);
+}
+
+/**
+ * Exit the process
+ */
+static __always_inline void __exit_process(const struct scheduler *sched,
+		struct process *p)
+{
+	/* Make sure the process is not attached to some list head */
+	assert(list_empty(&p->list));
+
+	/* Make sure the process is not holding any resource */
+	assert(list_empty(&p->__resources_holding));
+
+	/* Make sure there is no pending resource to acquire */
+	assert(list_empty(&p->__resources_to_acquire));
+
+	/* Make sure there is no pending I/O to perform */
+	assert(list_empty(&p->__io_to_perform));
+
+	if (sched->exiting) instrument(INSTRUMENT_EXITING, sched->exiting(p));
+
+	__print_event(p->pid, "X");
+	__nr_alive--;
+
+	/* The successors can be forked once all their predecessors exit */
+	for (int i = 0; i < p->__nr_successors; i++) {
+		p->__successors[i]->__nr_waiting_for--;
+	}
+	__free_process(p);
+}
+
+
+/**
+ * Called back when a timed acquisition is not made in time. If the process
+ * is still waiting for the resource, take it out of the waitqueue and make
+ * it ready so that it gives up (or retries) the acquisition when it runs next
+ */
+static void __acquire_timeout(struct timer *timer)
+{
+	struct resource_schedule *rs =
+			container_of(timer, struct resource_schedule, timer);
+	struct process *p = rs->process;
+
+	if (p->status != PROCESS_WAIT ||
+			p->blocked_on != resources + rs->resource_id) return;
+
+	assert(sched->cancel && "scheduler.cancel() not implemented");
+	instrument(INSTRUMENT_CANCEL, sched->cancel(rs->resource_id, p));
+	deactivate_resource(resources + rs->resource_id);
+
+	p->status = PROCESS_READY;
+	list_add_tail(&p->list, &readyqueue);
+
+	__nr_waiting--;
+	schedstat.nr_wakeups++;
+}
+
+/**
+ * Check whether the timed acquisition @rs should be given up now
+ */
+static bool __acquire_timed_out(struct resource_schedule *rs, struct resource *r)
+{
+	if (rs->timeout < 0 || resource_available(r, current)) return false;
+
+	/* tryacquire gives up at once whereas the others after waiting */
+	if (!rs->blocked) return rs->timeout == 0;
+
+	return ticks >= rs->deadline;
+}
+
+/**
+ * Process resource acqutision
+ */
+enum acquire_result {
+	ACQUIRED,
+	SPINNING,
+	BLOCKED,
+	SUSPENDED,	/* Started I/O before making a progress. For programs only */
+};
+
+static __always_inline enum acquire_result __run_current_acquire(
+		const struct scheduler *sched)
+{
+	struct resource_schedule *rs, *tmp;
+
+	list_for_each_entry_safe(rs, tmp, &current->__resources_to_acquire, list) {
+		if (rs->at == current->age) {
+			struct resource *r = resources + rs->resource_id;
+			int spin = rs->spin >= 0 ? rs->spin : r->spin;
+			bool acquired;
+
+			assert(sched->acquire && "scheduler.acquire() not implemented");
+
+			current->acquire_shared = rs->shared;
+
+			if (__acquire_timed_out(rs, r)) {
+				__print_event(current->pid, "!%d", r->id);
+				r->nr_timeouts++;
+
+				if (!rs->retry) {
+					/* Give up and go ahead without the resource */
+					list_del(&rs->list);
+					free(rs);
+					continue;
+				}
+
+				/* Start over the acquisition from the tail of the waitqueue */
+				rs->blocked = false;
+				rs->spun = 0;
+			}
+
+			/**
+			 * Keep spinning on the processor while the resource is taken
+			 * and the spin budget remains. The scheduler gets involved only
+			 * when the process actually acquires the resource or gets blocked
+			 */
+			if (!rs->blocked && rs->spun < spin && !resource_available(r, current)) {
+				rs->spun++;
+				r->spin_ticks++;
+				return SPINNING;
+			}
+
+			/* Callback to acquire the resource */
+			instrument(INSTRUMENT_ACQUIRE, acquired = sched->acquire(rs->resource_id));
+			if (acquired) {
+				if (rs->spun && !rs->blocked) r->nr_spin_acquired++;
+				del_timer(&rs->timer);
+
+				list_move_tail(&rs->list, &current->__resources_holding);
+				activate_resource(r);
+
+				__print_event(current->pid, "+%d", r->id);
+			} else {
+				if (rs->spun && !rs->blocked) r->nr_spin_blocked++;
+
+				/* Start the clock when the process gets blocked first */
+				if (rs->timeout > 0 && !rs->blocked) {
+					rs->deadline = ticks + rs->timeout;
+					add_timer(&rs->timer, rs->deadline);
+				}
+				rs->blocked = true;
+
+				current->blocked_on = r;
+				return BLOCKED;
+			}
+		}
+	}
+
+	return ACQUIRED;
+}
+
+/**
+ * Check whether @p waits for a resource with a timeout
+ */
+static bool __waiting_timed(struct process *p)
+{
+	struct resource_schedule *rs;
+
+	list_for_each_entry(rs, &p->__resources_to_acquire, list) {
+		if (timer_pending(&rs->timer)) return true;
+	}
+	return false;
+}
+
+/* Exit status when a deadlock aborts the simulation. Keep it in the Makefile */
+#define EXIT_DEADLOCK	2
+
+/**
+ * Check whether @p closes a cycle in the wait-for graph by being blocked.
+ * The graph consists of the edges from blocked processes to the resources
+ * they are waiting for (@blocked_on) and the edges from the resources to
+ * their owners. As a cycle is checked whenever an edge is added, @p should
+ * be on the cycle if any. So, following the chain from @p is enough, which
+ * takes time proportional to the length of the chain.
+ */
+static void __check_deadlock(struct process *p)
+{
+	struct resource *r = p->blocked_on;
+
+	while (r && r->owner != p) {
+		if (!r->owner || r->owner->status != PROCESS_WAIT) return;
+		r = r->owner->blocked_on;
+	}
+	if (!r) return;
+
+	/* A cycle is not a deadlock if a process on it will time out */
+	if (__waiting_timed(p)) return;
+	r = p->blocked_on;
+	do {
+		if (__waiting_timed(r->owner)) return;
+		r = r->owner->blocked_on;
+	} while (r->owner != p);
+
+	/* Report the cycle and abort the simulation */
+	fprintf(stderr, "%3d: deadlock: %d", ticks, p->pid);
+	r = p->blocked_on;
+	do {
+		fprintf(stderr, " -> #%d -> %d", r->id, r->owner->pid);
+		r = r->owner->blocked_on;
+	} while (r->owner != p);
+	fprintf(stderr, " -> #%d -> %d\n", r->id, p->pid);
+
+	if (!quiet) dump_status();
+
+	exit(EXIT_DEADLOCK);
+}
+
+/**
+ * Process resource release
+ */
+static unsigned int __nr_waiters(struct resource *r)
+{
+	unsigned int nr = 0;
+	struct list_head *pos;
+
+	list_for_each(pos, &r->waitqueue) nr++;
+	return nr;
+}
+
+static __always_inline void __release_resource(const struct scheduler *sched,
+		struct resource_schedule *rs)
+{
+	unsigned int nr_waiters = 0;
+
+	assert(sched->release && "scheduler.release() not implemented");
+
+	/* Count the waiters woken up by the release */
+	if (__schedstat) nr_waiters = __nr_waiters(resources + rs->resource_id);
+
+	/* Callback the release() */
+	instrument(INSTRUMENT_RELEASE, sched->release(rs->resource_id));
+
+	if (__schedstat) {
+		nr_waiters -= __nr_waiters(resources + rs->resource_id);
+		__nr_waiting -= nr_waiters;
+		schedstat.nr_wakeups += nr_waiters;
+	}
+	deactivate_resource(resources + rs->resource_id);
+
+	__print_event(current->pid, "-%d", resources[rs->resource_id].id);
+
+	list_del(&rs->list);
+	free(rs);
+}
+
+static __always_inline void __run_current_release(const struct scheduler *sched)
+{
+	struct resource_schedule *rs, *tmp;
+
+	list_for_each_entry_safe(rs, tmp, &current->__resources_holding, list) {
+		/* Resources acquired by programs are held until they are released */
+		if (rs->duration > 0 && --rs->duration == 0) {
+			__release_resource(sched, rs);
+		}
+	}
+}
+
+
+/**
+ * Start I/O if it is scheduled at the current age. The process is blocked
+ * until a timer completes the I/O
+ */
+static void __start_io(struct io_schedule *io)
+{
+	current->status = PROCESS_IO;
+	add_timer(&io->timer, ticks + 1 + io->duration);
+
+	__nr_io++;
+	schedstat.nr_blocks++;
+
+	__print_event(current->pid, "I");
+}
+
+static void __run_current_io()
+{
+	struct io_schedule *io;
+
+	list_for_each_entry(io, &current->__io_to_perform, list) {
+		if (io->at == current->age) {
+			list_del_init(&io->list);
+			__start_io(io);
+			return;
+		}
+	}
+}
+
+/**
+ * Called back when I/O is completed. Make the process ready again
+ */
+static void __complete_io(struct timer *timer)
+{
+	struct io_schedule *io = container_of(timer, struct io_schedule, timer);
+	struct process *p = io->process;
+
+	assert(p->status == PROCESS_IO);
+
+	p->status = PROCESS_READY;
+	list_add_tail(&p->list, &readyqueue);
+
+	__print_event(p->pid, "W");
+
+	__nr_io--;
+	schedstat.nr_wakeups++;
+
+	free(io);
+}
+
+
+/**
+ * Run the program of @current until it comes to compute. Acquisitions are
+ * made only when @acquire is set, i.e., at the beginning of a tick as the
+ * scripted ones. Releases, forks, and loops are done on the way, and I/O
+ * suspends the program
+ */
+static __always_inline enum acquire_result __run_current_program(
+		const struct scheduler *sched, bool acquire)
+{
+	struct program *prog = current->__program;
+
+	while (prog->pc < prog->nr_code) {
+		struct instruction *inst = prog->code + prog->pc;
+		struct resource_schedule *rs;
+		struct io_schedule *io;
+		enum acquire_result ret;
+
+		switch (inst->op) {
+		case OP_COMPUTE:
+			if (!prog->left) prog->left = inst->arg;
+			return ACQUIRED;
+
+		case OP_ACQUIRE:
+		case OP_ACQUIRE_SHARED:
+			if (!acquire) return ACQUIRED;
+
+			/* Schedule the acquisition now unless it is being retried */
+			if (list_empty(&current->__resources_to_acquire)) {
+				rs = __alloc_resource_schedule(current, inst->arg);
+				rs->at = current->age;
+				rs->duration = -1;
+				rs->shared = inst->op == OP_ACQUIRE_SHARED;
+				list_add_tail(&rs->list, &current->__resources_to_acquire);
+			}
+
+			ret = __run_current_acquire(sched);
+			if (ret != ACQUIRED) return ret;
+			break;
+
+		case OP_RELEASE:
+			list_for_each_entry(rs, &current->__resources_holding, list) {
+				if (rs->resource_id == inst->arg) break;
+			}
+			if (&rs->list == &current->__resources_holding) {
+				fprintf(stderr, "%3d: process %d releases resource %d not held\n",
+						ticks, current->pid, resources[inst->arg].id);
+				exit(EXIT_FAILURE);
+			}
+			__release_resource(sched, rs);
+			break;
+
+		case OP_IO:
+			io = malloc(sizeof(*io));
+			io->at = current->age;
+			io->duration = inst->arg;
+			init_timer(&io->timer, __complete_io);
+			io->process = current;
+
+			prog->pc++;
+			__start_io(io);
+			return SUSPENDED;
+
+		case OP_LOOP:
+			if (!inst->arg) {
+				prog->pc = inst->target;
+				continue;
+			}
+			prog->loops[prog->depth++] = inst->arg;
+			break;
+
+		case OP_ENDLOOP:
+			if (--prog->loops[prog->depth - 1]) {
+				prog->pc = inst->target;
+				continue;
+			}
+			prog->depth--;
+			break;
+
+		case OP_FORK:
+			assert(inst->child->__nr_waiting_for);
+			inst->child->__nr_waiting_for--;
+			break;
+		}
+		prog->pc++;
+	}
+
+	return ACQUIRED;
+}
+
+/**
+ * Account the tick computed by @current, and move on to the next instruction
+ * if the current compute is done
+ */
+static __always_inline void __advance_current_program(const struct scheduler *sched)
+{
+	struct program *prog = current->__program;
+
+	if (--prog->left) return;
+
+	prog->pc++;
+	__run_current_program(sched, false);
+}
+
+
+/**
+ * Ask scheduler to pick the next process to run
+ */
+static __always_inline void __schedule(const struct scheduler *sched)
+{
+	instrument(INSTRUMENT_SCHEDULE, current = sched->schedule());
+	schedstat.nr_schedule++;
+
+	/* Processes woken up in throttled groups cannot run. Park them */
+	while (current && process_throttled(current)) {
+		park_process(current);
+		current = NULL;
+		instrument(INSTRUMENT_SCHEDULE, current = sched->schedule());
+		schedstat.nr_schedule++;
+	}
+}
+
+/**
+ * Sample the ready-queue length for the scheduling statistics, and the state
+ * of the system every @sample_interval ticks. Also take a snapshot every
+ * @snapshot_interval ticks
+ */
+static __always_inline void __sample(void)
+{
+	unsigned int nr_unblocked =
+			__nr_alive - (current ? 1 : 0) - __nr_io - nr_parked_processes;
+
+	if (__schedstat) schedstat_sample(nr_unblocked - __nr_waiting);
+
+	if (sample_interval && ticks % sample_interval == 0) take_sample(nr_unblocked);
+
+	if (snapshot_interval && ticks % snapshot_interval == 0) take_snapshot();
+}
+
+
+/***********************************************************************
+ * Checkpoint and restore of the simulation. See checkpoint.h
+ */
+#define CHECKPOINT_MAGIC	0x54504b43	/* "CKPT" */
+#define CHECKPOINT_VERSION	2
+
+static FILE *__checkpoint_file = NULL;
+static bool __checkpoint_armed = false;
+static unsigned int __checkpoint_at = 0;
+static char *__checkpoint_name = "checkpoint.bin";
+
+/* To bind a checkpoint to the script it is taken with */
+static unsigned long long __script_hash = 0;
+
+void checkpoint_put(const void *data, size_t size)
+{
+	if (size) fwrite(data, size, 1, __checkpoint_file);
+}
+
+void checkpoint_get(void *data, size_t size)
+{
+	if (size && fread(data, size, 1, __checkpoint_file) != 1) {
+		fprintf(stderr, "Checkpoint is truncated\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void checkpoint_put_uint(unsigned int value)
+{
+	checkpoint_put(&value, sizeof(value));
+}
+
+unsigned int checkpoint_get_uint(void)
+{
+	unsigned int value;
+
+	checkpoint_get(&value, sizeof(value));
+	return value;
+}
+
+void checkpoint_put_process(struct process *p)
+{
+	checkpoint_put_uint(p ? p->__index + 1 : 0);
+}
+
+struct process *checkpoint_get_process(void)
+{
+	unsigned int index = checkpoint_get_uint();
+
+	if (index > __nr_processes) {
+		fprintf(stderr, "Checkpoint refers to process #%d not in the script\n", index - 1);
+		exit(EXIT_FAILURE);
+	}
+	if (index && !__process_at(index - 1)) {
+		fprintf(stderr, "Checkpoint refers to process #%d exited already\n", index - 1);
+		exit(EXIT_FAILURE);
+	}
+	return index ? __process_at(index - 1) : NULL;
+}
+
+void checkpoint_for_each_process(void (*fn)(struct process *))
+{
+	for (int i = 0; i < __nr_processes; i++) {
+		struct process *p = __process_at(i);
+
+		if (p && p->__forked) fn(p);
+	}
+}
+
+static void __put_list(struct list_head *head)
+{
+	struct process *p;
+	unsigned int nr = 0;
+
+	list_for_each_entry(p, head, list) nr++;
+
+	checkpoint_put_uint(nr);
+	list_for_each_entry(p, head, list) {
+		checkpoint_put_process(p);
+	}
+}
+
+static void __get_list(struct list_head *head)
+{
+	unsigned int nr = checkpoint_get_uint();
+
+	for (int i = 0; i < nr; i++) {
+		list_add_tail(&checkpoint_get_process()->list, head);
+	}
+}
+
+static void __put_resource_schedule(struct resource_schedule *rs)
+{
+	checkpoint_put(&rs->resource_id, sizeof(rs->resource_id));
+	checkpoint_put(&rs->at, sizeof(rs->at));
+	checkpoint_put(&rs->duration, sizeof(rs->duration));
+	checkpoint_put(&rs->shared, sizeof(rs->shared));
+	checkpoint_put(&rs->spin, sizeof(rs->spin));
+	checkpoint_put(&rs->spun, sizeof(rs->spun));
+	checkpoint_put(&rs->blocked, sizeof(rs->blocked));
+	checkpoint_put(&rs->timeout, sizeof(rs->timeout));
+	checkpoint_put(&rs->retry, sizeof(rs->retry));
+	checkpoint_put(&rs->deadline, sizeof(rs->deadline));
+}
+
+static void __put_resource_schedules(struct list_head *head)
+{
+	struct resource_schedule *rs;
+	unsigned int nr = 0;
+
+	list_for_each_entry(rs, head, list) nr++;
+
+	checkpoint_put_uint(nr);
+	list_for_each_entry(rs, head, list) {
+		__put_resource_schedule(rs);
+	}
+}
+
+static void __get_resource_schedules(struct process *p, struct list_head *head)
+{
+	unsigned int nr = checkpoint_get_uint();
+
+	for (int i = 0; i < nr; i++) {
+		struct resource_schedule *rs = __alloc_resource_schedule(p, 0);
+
+		checkpoint_get(&rs->resource_id, sizeof(rs->resource_id));
+		checkpoint_get(&rs->at, sizeof(rs->at));
+		checkpoint_get(&rs->duration, sizeof(rs->duration));
+		checkpoint_get(&rs->shared, sizeof(rs->shared));
+		checkpoint_get(&rs->spin, sizeof(rs->spin));
+		checkpoint_get(&rs->spun, sizeof(rs->spun));
+		checkpoint_get(&rs->blocked, sizeof(rs->blocked));
+		checkpoint_get(&rs->timeout, sizeof(rs->timeout));
+		checkpoint_get(&rs->retry, sizeof(rs->retry));
+		checkpoint_get(&rs->deadline, sizeof(rs->deadline));
+
+		if (rs->resource_id < 0 || rs->resource_id >= nr_resources) {
+			fprintf(stderr, "Checkpoint refers to resource #%d not in the script\n",
+					rs->resource_id);
+			exit(EXIT_FAILURE);
+		}
+		list_add_tail(&rs->list, head);
+	}
+}
+
+static struct io_schedule *__alloc_io_schedule(struct process *p)
+{
+	struct io_schedule *io = malloc(sizeof(*io));
+
+	init_timer(&io->timer, __complete_io);
+	io->process = p;
+	INIT_LIST_HEAD(&io->list);
+
+	return io;
+}
+
+static void __put_io_schedules(struct list_head *head)
+{
+	struct io_schedule *io;
+	unsigned int nr = 0;
+
+	list_for_each_entry(io, head, list) nr++;
+
+	checkpoint_put_uint(nr);
+	list_for_each_entry(io, head, list) {
+		checkpoint_put(&io->at, sizeof(io->at));
+		checkpoint_put(&io->duration, sizeof(io->duration));
+	}
+}
+
+static void __get_io_schedules(struct process *p, struct list_head *head)
+{
+	unsigned int nr = checkpoint_get_uint();
+
+	for (int i = 0; i < nr; i++) {
+		struct io_schedule *io = __alloc_io_schedule(p);
+
+		checkpoint_get(&io->at, sizeof(io->at));
+		checkpoint_get(&io->duration, sizeof(io->duration));
+		list_add_tail(&io->list, head);
+	}
+}
+
+/* Drop the schedules loaded from the script to replace them */
+static void __free_schedules(struct process *p)
+{
+	struct resource_schedule *rs, *rs_tmp;
+	struct io_schedule *io, *io_tmp;
+
+	list_for_each_entry_safe(rs, rs_tmp, &p->__resources_to_acquire, list) {
+		list_del(&rs->list);
+		free(rs);
+	}
+	list_for_each_entry_safe(rs, rs_tmp, &p->__resources_holding, list) {
+		list_del(&rs->list);
+		free(rs);
+	}
+	list_for_each_entry_safe(io, io_tmp, &p->__io_to_perform, list) {
+		list_del(&io->list);
+		free(io);
+	}
+}
+
+static void __put_process(struct process *p)
+{
+	enum process_status status = p ? p->status : PROCESS_EXIT;
+
+	/* Exited processes are freed and have nothing more */
+	checkpoint_put(&status, sizeof(status));
+	if (!p) return;
+
+	checkpoint_put(&p->__forked, sizeof(p->__forked));
+	checkpoint_put_uint(p->age);
+	checkpoint_put_uint(p->prio);
+	checkpoint_put(&p->acquire_shared, sizeof(p->acquire_shared));
+	checkpoint_put_uint(p->blocked_on ? p->blocked_on - resources + 1 : 0);
+	checkpoint_put(&p->wait_seq, sizeof(p->wait_seq));
+	checkpoint_put_uint(p->__nr_waiting_for);
+
+	if (p->__program) {
+		struct program *prog = p->__program;
+
+		checkpoint_put(&prog->pc, sizeof(prog->pc));
+		checkpoint_put_uint(prog->left);
+		checkpoint_put(&prog->depth, sizeof(prog->depth));
+		checkpoint_put(prog->loops, sizeof(*prog->loops) * prog->depth);
+	}
+
+	__put_resource_schedules(&p->__resources_to_acquire);
+	__put_resource_schedules(&p->__resources_holding);
+	__put_io_schedules(&p->__io_to_perform);
+}
+
+static void __get_process(struct process *p)
+{
+	unsigned int blocked_on;
+
+	INIT_LIST_HEAD(&p->list);
+	__free_schedules(p);
+
+	checkpoint_get(&p->status, sizeof(p->status));
+	if (p->status == PROCESS_EXIT) {
+		__free_process(p);
+		return;
+	}
+
+	checkpoint_get(&p->__forked, sizeof(p->__forked));
+	p->age = checkpoint_get_uint();
+	p->prio = checkpoint_get_uint();
+	checkpoint_get(&p->acquire_shared, sizeof(p->acquire_shared));
+	blocked_on = checkpoint_get_uint();
+	p->blocked_on = blocked_on ? resources + blocked_on - 1 : NULL;
+	checkpoint_get(&p->wait_seq, sizeof(p->wait_seq));
+	p->__nr_waiting_for = checkpoint_get_uint();
+
+	if (p->__program) {
+		struct program *prog = p->__program;
+
+		checkpoint_get(&prog->pc, sizeof(prog->pc));
+		prog->left = checkpoint_get_uint();
+		checkpoint_get(&prog->depth, sizeof(prog->depth));
+		if (prog->depth < 0 || prog->depth > prog->max_depth) {
+			fprintf(stderr, "Checkpoint does not match the program of process %d\n",
+					p->pid);
+			exit(EXIT_FAILURE);
+		}
+		checkpoint_get(prog->loops, sizeof(*prog->loops) * prog->depth);
+	}
+
+	__get_resource_schedules(p, &p->__resources_to_acquire);
+	__get_resource_schedules(p, &p->__resources_holding);
+	__get_io_schedules(p, &p->__io_to_perform);
+}
+
+static void __put_resource(struct resource *r)
+{
+	checkpoint_put_process(r->owner);
+	checkpoint_put_uint(r->nr_holders);
+	checkpoint_put_uint(r->donor_prio);
+	checkpoint_put_uint(r->spin_ticks);
+	checkpoint_put_uint(r->nr_spin_acquired);
+	checkpoint_put_uint(r->nr_spin_blocked);
+	checkpoint_put_uint(r->nr_timeouts);
+
+	__put_list(&r->waitqueue);
+
+	/* The heap is restored as it is by pushing the nodes in the array order */
+	checkpoint_put_uint(r->waiters.nr_nodes);
+	for (int i = 0; i < r->waiters.nr_nodes; i++) {
+		checkpoint_put_process(heap_entry(r->waiters.nodes[i], struct process, wait_node));
+	}
+}
+
+static void __get_resource(struct resource *r)
+{
+	unsigned int nr;
+
+	r->owner = checkpoint_get_process();
+	r->nr_holders = checkpoint_get_uint();
+	r->donor_prio = checkpoint_get_uint();
+	r->spin_ticks = checkpoint_get_uint();
+	r->nr_spin_acquired = checkpoint_get_uint();
+	r->nr_spin_blocked = checkpoint_get_uint();
+	r->nr_timeouts = checkpoint_get_uint();
+
+	__get_list(&r->waitqueue);
+
+	nr = checkpoint_get_uint();
+	for (int i = 0; i < nr; i++) {
+		heap_push(&r->waiters, &checkpoint_get_process()->wait_node);
+	}
+}
+
+static void __put_donors(struct process *p)
+{
+	checkpoint_put_uint(p->donors.nr_nodes);
+	for (int i = 0; i < p->donors.nr_nodes; i++) {
+		struct resource *r = heap_entry(p->donors.nodes[i], struct resource, donor_node);
+
+		checkpoint_put_uint(r - resources);
+	}
+}
+
+static void __get_donors(struct process *p)
+{
+	unsigned int nr = checkpoint_get_uint();
+
+	for (int i = 0; i < nr; i++) {
+		unsigned int index = checkpoint_get_uint();
+
+		if (index >= nr_resources) {
+			fprintf(stderr, "Checkpoint refers to resource #%d not in the script\n", index);
+			exit(EXIT_FAILURE);
+		}
+		heap_push(&p->donors, &resources[index].donor_node);
+	}
+}
+
+static void __put_group(struct group *g)
+{
+	checkpoint_put_uint(g->usage);
+	checkpoint_put_uint(g->period_start);
+	checkpoint_put(&g->throttled, sizeof(g->throttled));
+	checkpoint_put_uint(g->nr_ticks);
+	checkpoint_put_uint(g->nr_throttled);
+	checkpoint_put_uint(g->throttled_ticks);
+	checkpoint_put_uint(g->throttled_at);
+
+	__put_list(&g->parked);
+}
+
+static void __get_group(struct group *g)
+{
+	g->usage = checkpoint_get_uint();
+	g->period_start = checkpoint_get_uint();
+	checkpoint_get(&g->throttled, sizeof(g->throttled));
+	g->nr_ticks = checkpoint_get_uint();
+	g->nr_throttled = checkpoint_get_uint();
+	g->throttled_ticks = checkpoint_get_uint();
+	g->throttled_at = checkpoint_get_uint();
+
+	__get_list(&g->parked);
+}
+
+/**
+ * Timers are embedded in the acquisitions waiting with timeouts, the I/O in
+ * flight, and the groups waiting for the next period. The I/O in flight is
+ * not on any list, so it is saved along with its timer
+ */
+enum checkpoint_timer {
+	TIMER_ACQUIRE,
+	TIMER_IO,
+	TIMER_GROUP,
+};
+
+static void __put_timers(void)
+{
+	struct timer *t;
+	unsigned int nr = 0;
+
+	list_for_each_entry(t, &timers, list) nr++;
+
+	checkpoint_put_uint(nr);
+	list_for_each_entry(t, &timers, list) {
+		checkpoint_put_uint(t->expires);
+
+		if (t->function == __acquire_timeout) {
+			struct resource_schedule *rs =
+					container_of(t, struct resource_schedule, timer);
+			struct resource_schedule *pos;
+			unsigned int index = 0;
+
+			list_for_each_entry(pos, &rs->process->__resources_to_acquire, list) {
+				if (pos == rs) break;
+				index++;
+			}
+			checkpoint_put_uint(TIMER_ACQUIRE);
+			checkpoint_put_process(rs->process);
+			checkpoint_put_uint(index);
+		} else if (t->function == __complete_io) {
+			struct io_schedule *io = container_of(t, struct io_schedule, timer);
+
+			checkpoint_put_uint(TIMER_IO);
+			checkpoint_put_process(io->process);
+			checkpoint_put(&io->at, sizeof(io->at));
+			checkpoint_put(&io->duration, sizeof(io->duration));
+		} else {
+			struct group *g;
+			unsigned int index = 0;
+
+			list_for_each_entry(g, &groups, list) {
+				if (&g->timer == t) break;
+				index++;
+			}
+			checkpoint_put_uint(TIMER_GROUP);
+			checkpoint_put_uint(index);
+		}
+	}
+}
+
+static void __get_timers(void)
+{
+	unsigned int nr = checkpoint_get_uint();
+
+	for (int i = 0; i < nr; i++) {
+		unsigned int expires = checkpoint_get_uint();
+		unsigned int kind = checkpoint_get_uint();
+		struct timer *timer = NULL;
+		struct process *p;
+		unsigned int index;
+
+		switch (kind) {
+		case TIMER_ACQUIRE: {
 			struct resource_schedule *rs;
-			assert(nr_tokens == 4);
 
-			rs = malloc(sizeof(*rs));
+			p = checkpoint_get_process();
+			index = checkpoint_get_uint();
+			list_for_each_entry(rs, &p->__resources_to_acquire, list) {
+				if (!index--) {
+					timer = &rs->timer;
+					break;
+				}
+			}
+			break;
+		}
+		case TIMER_IO: {
+			struct io_schedule *io = __alloc_io_schedule(checkpoint_get_process());
 
-			rs->resource_id = atoi(tokens[1]);
-			rs->at = atoi(tokens[2]);
-			rs->duration = atoi(tokens[3]);
+			checkpoint_get(&io->at, sizeof(io->at));
+			checkpoint_get(&io->duration, sizeof(io->duration));
+			timer = &io->timer;
+			break;
+		}
+		case TIMER_GROUP: {
+			struct group *g;
+
+			index = checkpoint_get_uint();
+			list_for_each_entry(g, &groups, list) {
+				if (!index--) {
+					timer = &g->timer;
+					break;
+				}
+			}
+			break;
+		}
+		}
 
-			list_add_tail(&rs->list, &p->__resources_to_acquire);
-		} else {
-			fprintf(stderr, "Unknown property %s\n", tokens[0]);
-			return false;
+		if (!timer) {
+			fprintf(stderr, "Checkpoint has a timer not in the script\n");
+			exit(EXIT_FAILURE);
 		}
+		add_timer(timer, expires);
+	}
+}
+
+static unsigned long long __hash_script(char * const filename)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	FILE *file = fopen(filename, "r");
+	int c;
+
+	if (!file) return 0;
+	while ((c = fgetc(file)) != EOF) {
+		hash = (hash ^ (unsigned char)c) * 1099511628211ULL;
 	}
 	fclose(file);
-	if (!quiet) printf("\n");
-	return true;
+	return hash;
 }
 
+static void __put_header(void)
+{
+	unsigned int len = strlen(sched->name);
+	unsigned int nr_groups = 0;
+	struct group *g;
+
+	list_for_each_entry(g, &groups, list) nr_groups++;
+
+	checkpoint_put_uint(CHECKPOINT_MAGIC);
+	checkpoint_put_uint(CHECKPOINT_VERSION);
+	checkpoint_put(&__script_hash, sizeof(__script_hash));
+	checkpoint_put_uint(len);
+	checkpoint_put(sched->name, len);
+	checkpoint_put_uint(__nr_processes);
+	checkpoint_put_uint(nr_resources);
+	checkpoint_put_uint(nr_groups);
+}
 
-/**
- * Fork process on schedule
- */
-static int __fork_on_schedule()
+static bool __get_header(void)
 {
-	int nr_forked = 0;
-	struct process *p, *tmp;
-	list_for_each_entry_safe(p, tmp, &__forkqueue, list) {
-		if (p->__starts_at <= ticks) {
-			list_move_tail(&p->list, &readyqueue);
-			p->status = PROCESS_READY;
-			__print_event(p->pid, "N");
-			if (sched->forked) sched->forked(p);
-			nr_forked++;
-		}
+	unsigned long long hash;
+	unsigned int len;
+	unsigned int nr_groups = 0;
+	char name[128];
+	struct group *g;
+
+	list_for_each_entry(g, &groups, list) nr_groups++;
+
+	if (checkpoint_get_uint() != CHECKPOINT_MAGIC ||
+			checkpoint_get_uint() != CHECKPOINT_VERSION) {
+		fprintf(stderr, "Not a checkpoint of this simulator\n");
+		return false;
 	}
-	return nr_forked;
+
+	checkpoint_get(&hash, sizeof(hash));
+	len = checkpoint_get_uint();
+	if (len >= sizeof(name)) len = sizeof(name) - 1;
+	checkpoint_get(name, len);
+	name[len] = '\0';
+
+	if (strcmp(name, sched->name)) {
+		fprintf(stderr, "Checkpoint is taken with %s scheduler\n", name);
+		return false;
+	}
+	if (hash != __script_hash || checkpoint_get_uint() != __nr_processes ||
+			checkpoint_get_uint() != nr_resources || checkpoint_get_uint() != nr_groups) {
+		fprintf(stderr, "Checkpoint is taken with another script\n");
+		return false;
+	}
+	return true;
 }
 
 /**
- * Exit the process
+ * Save the simulation at the beginning of a tick, i.e., before timers fire
  */
-static void __exit_process(struct process *p)
+static void __checkpoint(void)
 {
-	/* Make sure the process is not attached to some list head */
-	assert(list_empty(&p->list));
+	struct resource *r;
+	struct group *g;
+	unsigned int nr_active = 0;
 
-	/* Make sure the process is not holding any resource */
-	assert(list_empty(&p->__resources_holding));
+	__checkpoint_armed = false;
 
-	/* Make sure there is no pending resource to acquire */
-	assert(list_empty(&p->__resources_to_acquire));
+	__checkpoint_file = fopen(__checkpoint_name, "w");
+	if (!__checkpoint_file) {
+		fprintf(stderr, "Unable to open %s\n", __checkpoint_name);
+		exit(EXIT_FAILURE);
+	}
 
-	if (sched->exiting) sched->exiting(p);
+	__put_header();
 
-	__print_event(p->pid, "X");
+	checkpoint_put_uint(ticks);
+	checkpoint_put_process(current);
+	checkpoint_put(&__wait_seq, sizeof(__wait_seq));
+	checkpoint_put_uint(__nr_alive);
+	checkpoint_put_uint(__nr_waiting);
+	checkpoint_put_uint(__nr_io);
+	checkpoint_put_uint(nr_parked_processes);
+	checkpoint_put(&schedstat, sizeof(schedstat));
 
-	free(p);
-}
+	for (int i = 0; i < __nr_processes; i++) {
+		__put_process(__process_at(i));
+	}
+	__put_list(&readyqueue);
+	__put_list(&__forkqueue);
 
+	for (int i = 0; i < nr_resources; i++) {
+		__put_resource(resources + i);
+	}
+	list_for_each_entry(r, &active_resources, active) nr_active++;
+	checkpoint_put_uint(nr_active);
+	list_for_each_entry(r, &active_resources, active) {
+		checkpoint_put_uint(r - resources);
+	}
 
-/**
- * Process resource acqutision
- */
-static bool __run_current_acquire()
-{
-	struct resource_schedule *rs, *tmp;
+	for (int i = 0; i < __nr_processes; i++) {
+		struct process *p = __process_at(i);
 
-	list_for_each_entry_safe(rs, tmp, &current->__resources_to_acquire, list) {
-		if (rs->at == current->age) {
-			assert(sched->acquire && "scheduler.acquire() not implemented");
+		if (p) __put_donors(p);
+	}
 
-			/* Callback to acquire the resource */
-			if (sched->acquire(rs->resource_id)) {
-				list_move_tail(&rs->list, &current->__resources_holding);
+	list_for_each_entry(g, &groups, list) {
+		__put_group(g);
+	}
 
-				__print_event(current->pid, "+%d", rs->resource_id);
-			} else {
-				return false;
-			}
-		}
+	__put_timers();
+
+	if (sched->checkpoint) sched->checkpoint();
+
+	if (fclose(__checkpoint_file)) {
+		fprintf(stderr, "Unable to write %s\n", __checkpoint_name);
+		exit(EXIT_FAILURE);
 	}
+	__checkpoint_file = NULL;
 
-	return true;
+	fprintf(stderr, "%3d: checkpointed into %s\n", ticks, __checkpoint_name);
 }
 
 /**
- * Process resource release
+ * Restore the simulation from @filename over the processes, resources, and
+ * groups loaded from the script
  */
-static void __run_current_release()
+static bool __restore(char * const filename)
 {
-	struct resource_schedule *rs, *tmp;
+	struct process *p;
+	struct group *g;
+	unsigned int nr;
 
-	list_for_each_entry_safe(rs, tmp, &current->__resources_holding, list) {
-		if (--rs->duration == 0) {
-			assert(sched->release && "scheduler.release() not implemented");
+	__checkpoint_file = fopen(filename, "r");
+	if (!__checkpoint_file) {
+		fprintf(stderr, "Unable to open %s\n", filename);
+		return false;
+	}
+
+	if (!__get_header()) {
+		fclose(__checkpoint_file);
+		return false;
+	}
+
+	ticks = checkpoint_get_uint();
+	current = checkpoint_get_process();
+	checkpoint_get(&__wait_seq, sizeof(__wait_seq));
+	__nr_alive = checkpoint_get_uint();
+	__nr_waiting = checkpoint_get_uint();
+	__nr_io = checkpoint_get_uint();
+	nr_parked_processes = checkpoint_get_uint();
+	checkpoint_get(&schedstat, sizeof(schedstat));
+
+	for (int i = 0; i < __nr_processes; i++) {
+		__get_process(__process_at(i));
+	}
+	INIT_LIST_HEAD(&readyqueue);
+	INIT_LIST_HEAD(&__forkqueue);
+	__get_list(&readyqueue);
+	__get_list(&__forkqueue);
 
-			/* Callback the release() */
-			sched->release(rs->resource_id);
+	/* Set up the processes forked before the checkpoint for the scheduler */
+	if (sched->forked) checkpoint_for_each_process(sched->forked);
 
-			__print_event(current->pid, "-%d", rs->resource_id);
+	for (int i = 0; i < nr_resources; i++) {
+		__get_resource(resources + i);
+	}
+	nr = checkpoint_get_uint();
+	for (int i = 0; i < nr; i++) {
+		unsigned int index = checkpoint_get_uint();
 
-			list_del(&rs->list);
-			free(rs);
+		if (index >= nr_resources) {
+			fprintf(stderr, "Checkpoint refers to resource #%d not in the script\n", index);
+			exit(EXIT_FAILURE);
 		}
+		list_add_tail(&resources[index].active, &active_resources);
 	}
+
+	for (int i = 0; i < __nr_processes; i++) {
+		p = __process_at(i);
+
+		if (p) __get_donors(p);
+	}
+
+	list_for_each_entry(g, &groups, list) {
+		__get_group(g);
+	}
+
+	__get_timers();
+
+	if (sched->restore) sched->restore();
+
+	fclose(__checkpoint_file);
+	__checkpoint_file = NULL;
+
+	fprintf(stderr, "%3d: restored from %s\n", ticks, filename);
+	return true;
 }
 
 
 /***********************************************************************
  * The main loop for the scheduler simulation
  */
-static void __do_simulation(void)
+static __always_inline void __simulate(const struct scheduler *sched)
 {
 	assert(sched->schedule && "scheduler.schedule() not implemented");
 
 	while (true) {
 		struct process *prev;
 
+		if (__checkpoint_armed && ticks == __checkpoint_at) __checkpoint();
+
+		/* Fire timers expiring at this tick */
+		run_timers();
+
 		/* Fork processes on schedule */
-		__fork_on_schedule();
+		__fork_on_schedule(sched);
 
 		/* Ask scheduler to pick the next process to run */
 		prev = current;
-		current = sched->schedule();
+		__schedule(sched);
+
+		/* The previous process is preempted if it could keep running */
+		if (prev && current != prev && prev->status == PROCESS_RUNNING &&
+				prev->age < prev->lifespan) {
+			schedstat.nr_preemptions++;
+		}
 
 		/* If the system ran a process in the previous tick, */
 		if (prev) {
@@ -340,30 +2021,43 @@ static void __do_simulation(void)
 			/* Decommission it if completed */
 			if (prev->age == prev->lifespan) {
 				prev->status = PROCESS_EXIT;
-				__exit_process(prev);
+				__exit_process(sched, prev);
+
+				/* Fork its successors, and run them at once if idle */
+				if (__fork_on_schedule(sched) && !current) __schedule(sched);
 			}
 		}
 
+		if (current != prev) schedstat.nr_switches++;
+
 		/* No process is ready to run at this moment */
 		if (!current) {
 			/* Quit simulation if no pending process exists */
-			if (list_empty(&readyqueue) && list_empty(&__forkqueue)) {
+			if (list_empty(&readyqueue) && list_empty(&__forkqueue) &&
+					!timers_pending()) {
 				break;
 			}
 
 			/* Idle temporarily */
 			fprintf(stderr, "%3d: idle\n", ticks);
+			schedstat.nr_idle_ticks++;
+			__sample();
 			goto next;
 		}
 
+		__sample();
+
 		/* Execute the current process */
 		current->status = PROCESS_RUNNING;
+		current->blocked_on = NULL;
 
 		/* Ensure that @current is detached from any list */
 		assert(list_empty(&current->list));
 
-		/* Try acquiring scheduled resources */
-		if (__run_current_acquire()) {
+		/* Try acquiring scheduled resources, or run the program until compute */
+		switch (current->__program ?
+				__run_current_program(sched, true) : __run_current_acquire(sched)) {
+		case ACQUIRED:
 			/* Succesfully acquired all the resources to make a progress! */
 			__print_event(current->pid, "%d", current->pid);
 
@@ -371,33 +2065,125 @@ static void __do_simulation(void)
 			current->age++;
 
 			/* And performs scheduled releases */
-			__run_current_release();
-		} else {
+			__run_current_release(sched);
+
+			/* And gets blocked if it starts I/O */
+			__run_current_io();
+
+			/* Or moves on in the program, which may release, fork, or start I/O */
+			if (current->__program) __advance_current_program(sched);
+
+			/* Charge the tick to the group, which might be throttled */
+			if (charge_group(current) && current->status == PROCESS_RUNNING &&
+					current->age < current->lifespan) {
+				park_process(current);
+			}
+			break;
+		case SPINNING:
+			/**
+			 * The current is spinning for a resource. It burns the tick
+			 * without making a progress, but still holds the processor
+			 */
+			__print_event(current->pid, "~");
+
+			if (charge_group(current)) {
+				park_process(current);
+			}
+			break;
+		case BLOCKED:
 			/**
 			 * The current is blocked while acquiring resource(s).
 			 * In this case, @current could not make a progress in this tick
 			 */
 			__print_event(current->pid, "=");
 
+			__nr_waiting++;
+			schedstat.nr_blocks++;
+
+			/* Abort if it results in a deadlock */
+			__check_deadlock(current);
+
 			/* Thus, it is not get aged nor unable to perform releases */
+			break;
+		case SUSPENDED:
+			/* The program started I/O before computing in this tick */
+			break;
 		}
 
 next:
 		/* Increase the tick counter */
 		ticks++;
+
+		if (schedstat_interval && ticks % schedstat_interval == 0) {
+			print_schedstat();
+		}
 	}
 }
 
+#ifdef CONFIG_SPECIALIZE
+/**
+ * Instantiate the simulation loop for each scheduler. The callbacks are
+ * resolved at compile time (at link time with LTO), so they can be called
+ * directly or even inlined into the loop.
+ */
+#define SIMULATION(policy) \
+static void __simulate_##policy(void) \
+{ \
+	__simulate(&policy##_scheduler); \
+}
 
-static void __initialize(void)
-{
-	INIT_LIST_HEAD(&readyqueue);
+SIMULATION(fifo)
+SIMULATION(sjf)
+SIMULATION(srtf)
+SIMULATION(psjf)
+SIMULATION(psrtf)
+SIMULATION(rr)
+SIMULATION(prio)
+SIMULATION(pip)
+SIMULATION(pcp)
+SIMULATION(cbs)
+SIMULATION(hfs)
+SIMULATION(cp)
+
+static const struct {
+	const struct scheduler *sched;
+	void (*simulate)(void);
+} __simulations[] = {
+	{ &fifo_scheduler, __simulate_fifo },
+	{ &sjf_scheduler, __simulate_sjf },
+	{ &srtf_scheduler, __simulate_srtf },
+	{ &psjf_scheduler, __simulate_psjf },
+	{ &psrtf_scheduler, __simulate_psrtf },
+	{ &rr_scheduler, __simulate_rr },
+	{ &prio_scheduler, __simulate_prio },
+	{ &pip_scheduler, __simulate_pip },
+	{ &pcp_scheduler, __simulate_pcp },
+	{ &cbs_scheduler, __simulate_cbs },
+	{ &hfs_scheduler, __simulate_hfs },
+	{ &cp_scheduler, __simulate_cp },
+};
 
-	for (int i = 0; i < NR_RESOURCES; i++) {
-		resources[i].owner = NULL;
-		INIT_LIST_HEAD(&(resources[i].waitqueue));
+static void __do_simulation(void)
+{
+	for (int i = 0; i < sizeof(__simulations) / sizeof(*__simulations); i++) {
+		if (__simulations[i].sched == sched) {
+			__simulations[i].simulate();
+			return;
+		}
 	}
+	__simulate(sched);
+}
+#else
+static void __do_simulation(void)
+{
+	__simulate(sched);
+}
+#endif
+
 
+static void __initialize(void)
+{
+	INIT_LIST_HEAD(&readyqueue);
 	INIT_LIST_HEAD(&__forkqueue);
 
 	if (quiet) return;
@@ -409,23 +2195,245 @@ static void __initialize(void)
 	printf("   N: Forked\n");
 	printf("   X: Finished\n");
 	printf("   =: Blocked\n");
+	printf("   ~: Spinning\n");
 	printf("  +n: Acquire resource n\n");
 	printf("  -n: Release resource n\n");
+	printf("  !n: Give up acquiring resource n\n");
+	printf("   I: Start I/O\n");
+	printf("   W: Wake up on I/O completion\n");
 	printf("\n");
 }
 
 
+static int __compare_pid(const void *a, const void *b)
+{
+	unsigned int pa = (*(struct process **)a)->pid;
+	unsigned int pb = (*(struct process **)b)->pid;
+
+	return pa < pb ? -1 : pa > pb;
+}
+
+static struct process **__find_process(struct process **processes, int nr, unsigned int pid)
+{
+	struct process key = { .pid = pid };
+	struct process *pkey = &key;
+
+	return bsearch(&pkey, processes, nr, sizeof(*processes), __compare_pid);
+}
+
+/**
+ * Resolve the dependencies among the processes into @__successors, and
+ * compute @critical_path of each process in the reverse topological order
+ * of the DAG. Return false if a process waits for or forks an unknown
+ * process, a process is forked more than once, or the processes wait for or
+ * fork each other so that some of them would never be forked
+ */
+static bool __setup_dependencies(void)
+{
+	struct process **processes, **order;
+	unsigned int *nr_waiting_for;
+	struct dependency *dep, *tmp;
+	struct process *p;
+	int nr = 0, head = 0, tail = 0;
+	bool ret = true;
+
+	list_for_each_entry(p, &__forkqueue, list) {
+		nr++;
+	}
+
+	processes = malloc(sizeof(*processes) * nr);
+	order = malloc(sizeof(*order) * nr);
+	nr_waiting_for = malloc(sizeof(*nr_waiting_for) * nr);
+
+	nr = 0;
+	list_for_each_entry(p, &__forkqueue, list) {
+		processes[nr++] = p;
+	}
+	qsort(processes, nr, sizeof(*processes), __compare_pid);
+
+	/* Processes are looked up by their pids below */
+	for (int i = 1; i < nr; i++) {
+		if (processes[i]->pid == processes[i - 1]->pid) {
+			fprintf(stderr, "Process %d is described more than once\n",
+					processes[i]->pid);
+			ret = false;
+			goto out;
+		}
+	}
+
+	list_for_each_entry_safe(dep, tmp, &__dependencies, list) {
+		struct process **pred = __find_process(processes, nr, dep->pid);
+
+		if (!pred) {
+			fprintf(stderr, "Process %d waits for unknown process %d\n",
+					dep->process->pid, dep->pid);
+			ret = false;
+			goto out;
+		}
+
+		(*pred)->__successors = realloc((*pred)->__successors,
+				sizeof(*(*pred)->__successors) * ((*pred)->__nr_successors + 1));
+		(*pred)->__successors[(*pred)->__nr_successors++] = dep->process;
+		dep->process->__nr_waiting_for++;
+
+		list_del(&dep->list);
+		free(dep);
+	}
+
+	/**
+	 * Processes forked by programs wait for their parents to fork them. A
+	 * process can be forked by one parent only. @nr_waiting_for counts the
+	 * parents for a while. It is indexed along @processes
+	 */
+	memset(nr_waiting_for, 0x00, sizeof(*nr_waiting_for) * nr);
+	for (int i = 0; i < nr; i++) {
+		struct program *prog = processes[i]->__program;
+
+		for (int j = 0; prog && j < prog->nr_code; j++) {
+			struct instruction *inst = prog->code + j;
+			struct process **child;
+
+			if (inst->op != OP_FORK) continue;
+
+			child = __find_process(processes, nr, inst->arg);
+			if (!child) {
+				fprintf(stderr, "Process %d forks unknown process %d\n",
+						processes[i]->pid, inst->arg);
+				ret = false;
+				goto out;
+			}
+			if (nr_waiting_for[child - processes]++) {
+				fprintf(stderr, "Process %d is forked more than once\n", inst->arg);
+				ret = false;
+				goto out;
+			}
+			inst->child = *child;
+			(*child)->__nr_waiting_for++;
+		}
+	}
+
+	/* Sort the processes topologically along the dependencies and the forks */
+	for (int i = 0; i < nr; i++) {
+		nr_waiting_for[i] = processes[i]->__nr_waiting_for;
+		if (!nr_waiting_for[i]) order[tail++] = processes[i];
+	}
+	while (head < tail) {
+		p = order[head++];
+		for (int i = 0; i < p->__nr_successors; i++) {
+			struct process **s = __find_process(processes, nr, p->__successors[i]->pid);
+			if (--nr_waiting_for[s - processes] == 0) order[tail++] = *s;
+		}
+		for (int i = 0; p->__program && i < p->__program->nr_code; i++) {
+			struct instruction *inst = p->__program->code + i;
+			struct process **s;
+
+			if (inst->op != OP_FORK) continue;
+
+			s = __find_process(processes, nr, inst->child->pid);
+			if (--nr_waiting_for[s - processes] == 0) order[tail++] = *s;
+		}
+	}
+	if (tail < nr) {
+		fprintf(stderr, "Processes wait for or fork each other\n");
+		ret = false;
+		goto out;
+	}
+
+	/* The critical path of a process extends the longest one of its successors */
+	while (tail--) {
+		unsigned int longest = 0;
+
+		p = order[tail];
+		for (int i = 0; i < p->__nr_successors; i++) {
+			if (p->__successors[i]->critical_path > longest) {
+				longest = p->__successors[i]->critical_path;
+			}
+		}
+		p->critical_path = p->lifespan + longest;
+	}
+
+out:
+	free(processes);
+	free(order);
+	free(nr_waiting_for);
+	return ret;
+}
+
+/**
+ * Initialize the resources referred by the processes, which are known after
+ * loading the process description file.
+ */
+static void __setup_resources(void)
+{
+	struct process *p;
+	struct resource_schedule *rs;
+
+	for (int i = 0; i < nr_resources; i++) {
+		init_resource(resources + i);
+	}
+
+	/* Compute the priority ceilings of the resources */
+	list_for_each_entry(p, &__forkqueue, list) {
+		list_for_each_entry(rs, &p->__resources_to_acquire, list) {
+			struct resource *r = resources + rs->resource_id;
+			if (p->prio_orig > r->ceiling) r->ceiling = p->prio_orig;
+		}
+
+		for (int i = 0; p->__program && i < p->__program->nr_code; i++) {
+			struct instruction *inst = p->__program->code + i;
+			struct resource *r = resources + inst->arg;
+
+			if (inst->op != OP_ACQUIRE && inst->op != OP_ACQUIRE_SHARED) continue;
+			if (p->prio_orig > r->ceiling) r->ceiling = p->prio_orig;
+		}
+	}
+}
+
+/**
+ * Expected length of the simulation to size the sample buffer. The processor
+ * is busy for the sum of the lifespans after the last fork at most unless
+ * processes spin or perform I/O
+ */
+static unsigned int __expected_ticks(void)
+{
+	unsigned int last_fork = 0;
+	unsigned int total = 0;
+	struct process *p;
+
+	list_for_each_entry(p, &__forkqueue, list) {
+		if (p->__starts_at > last_fork) last_fork = p->__starts_at;
+		total += p->lifespan;
+	}
+	return last_fork + total;
+}
+
+
 static void __print_usage(char * const name)
 {
-	printf("Usage: %s {-q} -[f|s|S|r|p|i] [process script file]\n", name);
+	printf("Usage: %s {-q} {-t} {-T ticks} {-k ticks} {-o file} {-y ticks} {-Y file} {-C tick} {-W file} {-R file} -[f|s|S|j|J|r|p|i|P|c|g|d] [process script file]\n", name);
 	printf("\n");
-	printf("  -q: Run quietly\n\n");
+	printf("  -q: Run quietly\n");
+	printf("  -t: Report the scheduling statistics at the end\n");
+	printf("  -T: Also print the scheduling statistics every @ticks ticks\n");
+	printf("  -k: Sample the queue lengths and utilization every @ticks ticks\n");
+	printf("  -o: Write the samples into @file (default: samples.csv)\n");
+	printf("  -y: Take a snapshot every @ticks ticks\n");
+	printf("  -Y: Write the snapshots into @file (default: snapshots.bin)\n");
+	printf("  -C: Checkpoint the simulation at @tick\n");
+	printf("  -W: Write the checkpoint into @file (default: checkpoint.bin)\n");
+	printf("  -R: Restore the simulation from checkpoint @file and continue\n\n");
 	printf("  -f: Use FIFO scheduler (default)\n");
 	printf("  -s: Use SJF scheduler\n");
 	printf("  -S: Use SRTF scheduler\n");
+	printf("  -j: Use SJF scheduler with burst prediction\n");
+	printf("  -J: Use SRTF scheduler with burst prediction\n");
 	printf("  -r: Use Round-robin scheduler\n");
 	printf("  -p: Use Priority scheduler\n");
-	printf("  -i: Use Priority with PIP scheduler\n\n");
+	printf("  -i: Use Priority with PIP scheduler\n");
+	printf("  -P: Use Priority with immediate priority ceiling scheduler\n");
+	printf("  -c: Use CBS reservations + Round-robin scheduler\n");
+	printf("  -g: Use Hierarchical fair-share scheduler\n");
+	printf("  -d: Use Critical-path first scheduler\n\n");
 }
 
 
@@ -433,12 +2441,55 @@ int main(int argc, char * const argv[])
 {
 	int opt;
 	char *scriptfile;
+	char *samplefile = "samples.csv";
+	char *snapshotfile = "snapshots.bin";
+	char *restorefile = NULL;
 
-	while ((opt = getopt(argc, argv, "qfsSrpih")) != -1) {
+	while ((opt = getopt(argc, argv, "qtT:k:o:y:Y:C:W:R:fsSjJrpiPcgdh")) != -1) {
 		switch (opt) {
 		case 'q':
 			quiet = true;
 			break;
+		case 'T':
+			schedstat_interval = atoi(optarg);
+			if (!schedstat_interval) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			/* fall through */
+		case 't':
+			__schedstat = true;
+			break;
+		case 'k':
+			sample_interval = atoi(optarg);
+			if (!sample_interval) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'o':
+			samplefile = optarg;
+			break;
+		case 'y':
+			snapshot_interval = atoi(optarg);
+			if (!snapshot_interval) {
+				__print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'Y':
+			snapshotfile = optarg;
+			break;
+		case 'C':
+			__checkpoint_armed = true;
+			__checkpoint_at = atoi(optarg);
+			break;
+		case 'W':
+			__checkpoint_name = optarg;
+			break;
+		case 'R':
+			restorefile = optarg;
+			break;
 
 		case 'f':
 			sched = &fifo_scheduler;
@@ -449,6 +2500,12 @@ int main(int argc, char * const argv[])
 		case 'S':
 			sched = &srtf_scheduler;
 			break;
+		case 'j':
+			sched = &psjf_scheduler;
+			break;
+		case 'J':
+			sched = &psrtf_scheduler;
+			break;
 		case 'r':
 			sched = &rr_scheduler;
 			break;
@@ -458,6 +2515,18 @@ int main(int argc, char * const argv[])
 		case 'i':
 			sched = &pip_scheduler;
 			break;
+		case 'P':
+			sched = &pcp_scheduler;
+			break;
+		case 'c':
+			sched = &cbs_scheduler;
+			break;
+		case 'g':
+			sched = &hfs_scheduler;
+			break;
+		case 'd':
+			sched = &cp_scheduler;
+			break;
 		case 'h':
 		default:
 			__print_usage(argv[0]);
@@ -478,16 +2547,66 @@ int main(int argc, char * const argv[])
 		return EXIT_FAILURE;
 	}
 
+	if (!__setup_dependencies()) {
+		return EXIT_FAILURE;
+	}
+
+	__setup_resources();
+
 	if (sched->initialize && sched->initialize()) {
 		return EXIT_FAILURE;
 	}
 
+	if (__checkpoint_armed || restorefile) {
+		__script_hash = __hash_script(scriptfile);
+	}
+
+	/* All the processes are yet to fork until the checkpoint is restored */
+	if (sample_interval) init_sampler(__expected_ticks());
+
+	if (restorefile && !__restore(restorefile)) {
+		return EXIT_FAILURE;
+	}
+
+	if (snapshot_interval && !init_snapshots(snapshotfile)) {
+		return EXIT_FAILURE;
+	}
+
+	instrument_start();
+
 	__do_simulation();
 
 	if (sched->finalize) {
 		sched->finalize();
 	}
 
+	instrument_report();
+
+	if (__schedstat) report_schedstat();
+
+	if (sample_interval && !write_samples(samplefile)) {
+		return EXIT_FAILURE;
+	}
+
+	if (!finish_snapshots()) {
+		return EXIT_FAILURE;
+	}
+
+	report_groups();
+	report_resources();
+
+	if (__dag_scripted) {
+		printf("- Makespan: %d ticks\n", ticks);
+	}
+
+	if (__io_scripted) {
+		printf("- Processor: busy %d ticks, idle %d ticks\n",
+				ticks - schedstat.nr_idle_ticks, schedstat.nr_idle_ticks);
+	}
+
+	__free_processes();
+	free_resources();
+
 	return EXIT_SUCCESS;
 }
 /*          ******        DO NOT MODIFY THIS FILE        ******       */
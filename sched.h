@@ -111,6 +111,46 @@ struct scheduler {
 	 *   Callbacked to release the resource @resource_id
 	 */
 	void (*release)(int);
+
+
+	/***********************************************************************
+	 * void cancel(int resource_id, struct process *process)
+	 *
+	 * DESCRIPTION
+	 *   Called back when @process waiting for the resource @resource_id
+	 *   gives up acquiring it (e.g., its acquisition times out). Take the
+	 *   process out of the waitqueue and undo what its waiting caused.
+	 *   The framework makes it ready and puts it into the ready queue.
+	 */
+	void (*cancel)(int, struct process *);
+
+
+	/***********************************************************************
+	 * void for_each_ready(void (*fn)(struct process *))
+	 *
+	 * DESCRIPTION
+	 *   Call @fn for each ready process that the scheduler has taken out of
+	 *   @readyqueue into its own structure. dump_status() and the snapshots
+	 *   list them in the ready queue ahead of the processes in @readyqueue.
+	 *   Leave this NULL if the scheduler keeps the ready processes in
+	 *   @readyqueue until it picks them.
+	 */
+	void (*for_each_ready)(void (*)(struct process *));
+
+
+	/***********************************************************************
+	 * void checkpoint(void)
+	 * void restore(void)
+	 *
+	 * DESCRIPTION
+	 *   Called back when the simulation is checkpointed and restored. Save
+	 *   the state of your own in checkpoint(), and load it back in restore()
+	 *   in the same order with the functions in checkpoint.h. You may leave
+	 *   these NULL if the scheduler keeps nothing but in the processes and
+	 *   the ready queue.
+	 */
+	void (*checkpoint)(void);
+	void (*restore)(void);
 };
 
 #endif
@@ -0,0 +1,64 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+
+#include "schedstat.h"
+
+extern unsigned int ticks;
+
+struct schedstat schedstat = {0};
+unsigned int schedstat_interval = 0;
+
+static double __ready_avg(void)
+{
+	return schedstat.nr_samples ?
+			(double)schedstat.ready_sum / schedstat.nr_samples : 0.0;
+}
+
+static double __visited_per_pick(void)
+{
+	return schedstat.nr_schedule ?
+			(double)schedstat.nr_visited / schedstat.nr_schedule : 0.0;
+}
+
+void print_schedstat(void)
+{
+	printf("schedstat ticks=%u schedule=%llu switches=%llu preemptions=%llu "
+			"blocks=%llu wakeups=%llu ready_avg=%.2f ready_max=%u "
+			"visited=%llu idle=%u\n",
+			ticks, schedstat.nr_schedule, schedstat.nr_switches,
+			schedstat.nr_preemptions, schedstat.nr_blocks, schedstat.nr_wakeups,
+			__ready_avg(), schedstat.ready_max,
+			schedstat.nr_visited, schedstat.nr_idle_ticks);
+}
+
+void report_schedstat(void)
+{
+	printf("- Schedule: %llu call%s, %llu context switch%s, %llu preemption%s\n",
+			schedstat.nr_schedule, schedstat.nr_schedule >= 2 ? "s" : "",
+			schedstat.nr_switches, schedstat.nr_switches >= 2 ? "es" : "",
+			schedstat.nr_preemptions, schedstat.nr_preemptions >= 2 ? "s" : "");
+	printf("- Blocking: %llu block%s, %llu wakeup%s\n",
+			schedstat.nr_blocks, schedstat.nr_blocks >= 2 ? "s" : "",
+			schedstat.nr_wakeups, schedstat.nr_wakeups >= 2 ? "s" : "");
+	printf("- Ready queue: %.2f processes on average, %u at most, "
+			"%.2f processes visited per pick\n",
+			__ready_avg(), schedstat.ready_max, __visited_per_pick());
+	printf("- Idle: %u tick%s\n",
+			schedstat.nr_idle_ticks, schedstat.nr_idle_ticks >= 2 ? "s" : "");
+
+	print_schedstat();
+}
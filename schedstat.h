@@ -0,0 +1,67 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __SCHEDSTAT_H__
+#define __SCHEDSTAT_H__
+
+/**
+ * Scheduling statistics in the flavor of /proc/schedstat. The framework
+ * counts the events in the simulation loop, and the policies count the
+ * processes they look into to pick the next one with schedstat_visit().
+ * The counters are reported at the end of the simulation with -t, and
+ * printed every @schedstat_interval ticks with -T.
+ */
+struct schedstat {
+	unsigned long long nr_schedule;		/* Calls to schedule() */
+	unsigned long long nr_switches;		/* Switches to a different process or idle */
+	unsigned long long nr_preemptions;	/* Switches from a runnable process */
+	unsigned long long nr_blocks;		/* Blocks on resources or I/O */
+	unsigned long long nr_wakeups;		/* Wake-ups from resources, timeouts, and I/O */
+	unsigned long long nr_visited;		/* Processes looked into to pick */
+
+	/* The ready-queue length sampled every tick */
+	unsigned long long ready_sum;
+	unsigned long long nr_samples;
+	unsigned int ready_max;
+
+	unsigned int nr_idle_ticks;
+};
+
+extern struct schedstat schedstat;
+extern unsigned int schedstat_interval;
+
+static inline void schedstat_visit(unsigned int nr)
+{
+	schedstat.nr_visited += nr;
+}
+
+static inline void schedstat_sample(unsigned int nr_ready)
+{
+	schedstat.ready_sum += nr_ready;
+	schedstat.nr_samples++;
+	if (nr_ready > schedstat.ready_max) schedstat.ready_max = nr_ready;
+}
+
+/**
+ * Print the counters so far in one line of key=value pairs
+ */
+void print_schedstat(void);
+
+/**
+ * Report the counters at the end of the simulation
+ */
+void report_schedstat(void);
+
+#endif
@@ -0,0 +1,177 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __SKIPLIST_H__
+#define __SKIPLIST_H__
+
+/*
+ * Intrusive skip list in the same flavor as heap.h.
+ *
+ * Embed struct skiplist_node into the structure to keep in the list, and get
+ * the structure back with skiplist_entry(). The list is ordered by @less(),
+ * and nodes with the same key are kept in the insertion order. The least node
+ * is at the front, so picking it is O(1) and insertions and deletions are
+ * O(log n) on average. The nodes can be walked in order along @next[0].
+ *
+ * A node is linked in the levels below a random level, where a node reaches
+ * each level above the first with the probability of 1/4. SKIPLIST_MAX_LEVEL
+ * levels serve up to 4^SKIPLIST_MAX_LEVEL nodes well. Deleting a node walks
+ * the nodes with the same key before it in the highest level of the node, so
+ * many nodes with the same key make deletions slower.
+ *
+ * Include list_head.h (for container_of) before this file.
+ */
+
+#define SKIPLIST_MAX_LEVEL	12
+
+struct skiplist_node {
+	struct skiplist_node *next[SKIPLIST_MAX_LEVEL];
+	unsigned int level;
+};
+
+struct skiplist {
+	struct skiplist_node head;
+	unsigned int level;		/* The highest level in use */
+	unsigned int nr_nodes;
+	unsigned int seed;		/* State of the level generator */
+	bool (*less)(struct skiplist_node *, struct skiplist_node *);
+};
+
+#define skiplist_entry(ptr, type, member) \
+	container_of(ptr, type, member)
+
+static inline void INIT_SKIPLIST(struct skiplist *list,
+		bool (*less)(struct skiplist_node *, struct skiplist_node *))
+{
+	for (int i = 0; i < SKIPLIST_MAX_LEVEL; i++) {
+		list->head.next[i] = NULL;
+	}
+	list->head.level = SKIPLIST_MAX_LEVEL;
+	list->level = 1;
+	list->nr_nodes = 0;
+	list->seed = 2463534242U;
+	list->less = less;
+}
+
+static inline bool skiplist_empty(const struct skiplist *list)
+{
+	return list->head.next[0] == NULL;
+}
+
+/**
+ * skiplist_first - get the least node in the list, or NULL if the list is empty
+ */
+static inline struct skiplist_node *skiplist_first(const struct skiplist *list)
+{
+	return list->head.next[0];
+}
+
+/* Draw the level of a new node with xorshift32 */
+static inline unsigned int __skiplist_random_level(struct skiplist *list)
+{
+	unsigned int x = list->seed;
+	unsigned int level = 1;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	list->seed = x;
+
+	while (level < SKIPLIST_MAX_LEVEL && (x & 0x3) == 0) {
+		level++;
+		x >>= 2;
+	}
+	return level;
+}
+
+/**
+ * skiplist_insert - add @node into the list after the nodes with the same key
+ */
+static inline void skiplist_insert(struct skiplist *list, struct skiplist_node *node)
+{
+	struct skiplist_node *prev = &list->head;
+	struct skiplist_node *update[SKIPLIST_MAX_LEVEL];
+
+	for (int i = list->level - 1; i >= 0; i--) {
+		while (prev->next[i] && !list->less(node, prev->next[i])) {
+			prev = prev->next[i];
+		}
+		update[i] = prev;
+	}
+
+	node->level = __skiplist_random_level(list);
+	for (int i = list->level; i < node->level; i++) {
+		update[i] = &list->head;
+	}
+	if (node->level > list->level) list->level = node->level;
+
+	for (int i = 0; i < node->level; i++) {
+		node->next[i] = update[i]->next[i];
+		update[i]->next[i] = node;
+	}
+	list->nr_nodes++;
+}
+
+/**
+ * skiplist_del - remove @node from the list
+ */
+static inline void skiplist_del(struct skiplist *list, struct skiplist_node *node)
+{
+	struct skiplist_node *prev = &list->head;
+
+	/**
+	 * Descend to the last node less than @node in each level. In the levels
+	 * @node is linked in, @node follows it after the nodes with the same key,
+	 * if any. The predecessor of @node is before @node in the lower levels
+	 * as well, so the walk continues from there
+	 */
+	for (int i = list->level - 1; i >= 0; i--) {
+		while (prev->next[i] && list->less(prev->next[i], node)) {
+			prev = prev->next[i];
+		}
+		if (i >= node->level) continue;
+
+		while (prev->next[i] != node) prev = prev->next[i];
+		prev->next[i] = node->next[i];
+	}
+
+	while (list->level > 1 && !list->head.next[list->level - 1]) {
+		list->level--;
+	}
+	list->nr_nodes--;
+}
+
+/**
+ * skiplist_pop - remove the least node from the list and return it
+ */
+static inline struct skiplist_node *skiplist_pop(struct skiplist *list)
+{
+	struct skiplist_node *first = skiplist_first(list);
+
+	if (!first) return NULL;
+
+	/* The first node is right after the head in all of its levels */
+	for (int i = 0; i < first->level; i++) {
+		list->head.next[i] = first->next[i];
+	}
+	while (list->level > 1 && !list->head.next[list->level - 1]) {
+		list->level--;
+	}
+	list->nr_nodes--;
+
+	return first;
+}
+
+#endif
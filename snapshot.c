@@ -0,0 +1,361 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "heap.h"
+
+#include "process.h"
+#include "resource.h"
+#include "snapshot.h"
+
+extern struct process *current;
+extern unsigned int ticks;
+
+unsigned int snapshot_interval = 0;
+
+/* Write out the buffer once it grows over this */
+#define SNAPSHOT_FLUSH_SIZE	(1U << 20)
+
+/* Growable byte buffer */
+struct __bytes {
+	unsigned char *data;
+	size_t len;
+	size_t size;
+};
+
+static void __reserve(struct __bytes *b, size_t len)
+{
+	if (b->len + len <= b->size) return;
+
+	while (b->len + len > b->size) {
+		b->size = b->size ? b->size * 2 : 4096;
+	}
+	b->data = realloc(b->data, b->size);
+}
+
+static void __put(struct __bytes *b, unsigned int value)
+{
+	__reserve(b, 5);
+	b->len += snapshot_put(b->data + b->len, value);
+}
+
+/* Queue of process indexes as recorded last time */
+struct __queue {
+	unsigned int *index;
+	unsigned int nr;
+	unsigned int size;
+};
+
+static void __queue_push(struct __queue *q, unsigned int index)
+{
+	if (q->nr == q->size) {
+		q->size = q->size ? q->size * 2 : 16;
+		q->index = realloc(q->index, sizeof(*q->index) * q->size);
+	}
+	q->index[q->nr++] = index;
+}
+
+/* Processes as recorded last time, by their indexes */
+struct __process_cache {
+	bool recorded;
+	unsigned int status;
+	unsigned int age;
+	unsigned int prio;
+};
+
+/* Resources as recorded last time */
+struct __resource_cache {
+	bool shown;
+	unsigned int owner;		/* index + 1 */
+	unsigned int nr_holders;
+	struct __queue waiters;
+};
+
+static FILE *__file = NULL;
+static struct __bytes __buffer = {0};
+
+static struct __process_cache *__processes = NULL;
+static unsigned int __nr_processes = 0;
+static struct __resource_cache *__resources = NULL;
+static struct __queue __shown = {0};		/* Resources shown last time */
+static struct __queue __readyqueue = {0};
+
+/* Parts of the snapshot being taken */
+static struct __bytes __process_records = {0};
+static unsigned int __nr_process_records = 0;
+static struct __bytes __resource_records = {0};
+static unsigned int __nr_resource_records = 0;
+static struct __bytes __queue_record = {0};
+static struct __bytes __active_record = {0};
+static struct __queue __queue = {0};
+static struct __bytes __record = {0};
+
+static void __record_process(struct process *p)
+{
+	struct __process_cache *pc;
+
+	if (p->__index >= __nr_processes) {
+		unsigned int nr = __nr_processes ? __nr_processes : 64;
+
+		while (nr <= p->__index) nr *= 2;
+		__processes = realloc(__processes, sizeof(*__processes) * nr);
+		memset(__processes + __nr_processes, 0x00,
+				sizeof(*__processes) * (nr - __nr_processes));
+		__nr_processes = nr;
+	}
+
+	pc = __processes + p->__index;
+	if (pc->recorded && pc->status == p->status &&
+			pc->age == p->age && pc->prio == p->prio) {
+		return;
+	}
+
+	pc->recorded = true;
+	pc->status = p->status;
+	pc->age = p->age;
+	pc->prio = p->prio;
+
+	__put(&__process_records, p->__index);
+	__put(&__process_records, p->pid);
+	__put(&__process_records, p->status);
+	__put(&__process_records, p->__starts_at);
+	__put(&__process_records, p->age);
+	__put(&__process_records, p->lifespan);
+	__put(&__process_records, p->prio);
+	__nr_process_records++;
+}
+
+static void __collect_process(struct process *p)
+{
+	__record_process(p);
+	__queue_push(&__queue, p->__index);
+}
+
+/**
+ * Collect the processes in @head into @__queue, recording them on the way
+ */
+static void __collect_queue(struct list_head *head)
+{
+	struct process *p;
+
+	__queue.nr = 0;
+	list_for_each_entry(p, head, list) {
+		__collect_process(p);
+	}
+}
+
+static bool __queue_changed(struct __queue *prev)
+{
+	return prev->nr != __queue.nr || (__queue.nr &&
+			memcmp(prev->index, __queue.index, sizeof(*__queue.index) * __queue.nr));
+}
+
+/**
+ * Encode @__queue against @prev into @b, and make @prev the same as @__queue
+ */
+static void __encode_queue(struct __bytes *b, struct __queue *prev)
+{
+	unsigned int dropped = prev->nr;
+	unsigned int kept;
+
+	/* Find where the new queue begins in the previous one */
+	if (__queue.nr) {
+		for (dropped = 0; dropped < prev->nr; dropped++) {
+			if (prev->index[dropped] == __queue.index[0]) break;
+		}
+	}
+	kept = prev->nr - dropped;
+
+	if (kept > __queue.nr || (kept &&
+			memcmp(prev->index + dropped, __queue.index, sizeof(*__queue.index) * kept))) {
+		/* Changed in the middle. Record all */
+		__put(b, 0);
+		__put(b, __queue.nr);
+		for (int i = 0; i < __queue.nr; i++) {
+			__put(b, __queue.index[i]);
+		}
+	} else {
+		__put(b, dropped + 1);
+		__put(b, __queue.nr - kept);
+		for (int i = kept; i < __queue.nr; i++) {
+			__put(b, __queue.index[i]);
+		}
+	}
+
+	prev->nr = 0;
+	for (int i = 0; i < __queue.nr; i++) {
+		__queue_push(prev, __queue.index[i]);
+	}
+}
+
+static void __record_resource(struct resource *r, bool active)
+{
+	struct __resource_cache *rc = __resources + (r - resources);
+	unsigned int owner = r->owner ? r->owner->__index + 1 : 0;
+
+	if (active) {
+		if (r->owner) __record_process(r->owner);
+		__collect_queue(&r->waitqueue);
+	} else {
+		__queue.nr = 0;
+	}
+
+	if (rc->shown == active && rc->owner == owner &&
+			rc->nr_holders == r->nr_holders && !__queue_changed(&rc->waiters)) {
+		return;
+	}
+
+	rc->shown = active;
+	rc->owner = owner;
+	rc->nr_holders = r->nr_holders;
+
+	__put(&__resource_records, r - resources);
+	__put(&__resource_records, r->id);
+	__put(&__resource_records, owner);
+	__put(&__resource_records, r->nr_holders);
+	__encode_queue(&__resource_records, &rc->waiters);
+	__nr_resource_records++;
+}
+
+static bool __flush(void)
+{
+	if (fwrite(__buffer.data, 1, __buffer.len, __file) != __buffer.len) {
+		fprintf(stderr, "Unable to write snapshots: %s\n", strerror(errno));
+		return false;
+	}
+	__buffer.len = 0;
+	return true;
+}
+
+/**
+ * The simulation may be aborted with exit() (e.g., on a deadlock), which is
+ * when the snapshots are needed the most. Write them out on the way
+ */
+static void __finish_at_exit(void)
+{
+	finish_snapshots();
+}
+
+bool init_snapshots(const char *filename)
+{
+	uint32_t header[2] = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION };
+
+	__file = fopen(filename, "w");
+	if (!__file) {
+		fprintf(stderr, "Unable to open %s: %s\n", filename, strerror(errno));
+		return false;
+	}
+	fwrite(header, sizeof(header), 1, __file);
+	atexit(__finish_at_exit);
+
+	__resources = calloc(nr_resources, sizeof(*__resources));
+	return true;
+}
+
+static void __append(struct __bytes *b, struct __bytes *from)
+{
+	if (!from->len) return;
+
+	__reserve(b, from->len);
+	memcpy(b->data + b->len, from->data, from->len);
+	b->len += from->len;
+}
+
+void take_snapshot(void)
+{
+	struct resource *r;
+
+	if (!__file) return;
+
+	__process_records.len = __nr_process_records = 0;
+	__resource_records.len = __nr_resource_records = 0;
+	__queue_record.len = 0;
+
+	if (current) __record_process(current);
+
+	__queue.nr = 0;
+	for_each_ready_process(__collect_process);
+	__encode_queue(&__queue_record, &__readyqueue);
+
+	/* Clear the resources shown last time but not owned nor waited for anymore */
+	for (int i = 0; i < __shown.nr; i++) {
+		r = resources + __shown.index[i];
+		if (list_empty(&r->active)) __record_resource(r, false);
+	}
+
+	list_for_each_entry(r, &active_resources, active) {
+		__record_resource(r, true);
+	}
+
+	/* dump_status() lists the resources in the order they became active */
+	__queue.nr = 0;
+	list_for_each_entry(r, &active_resources, active) {
+		__queue_push(&__queue, r - resources);
+	}
+	__active_record.len = 0;
+	__encode_queue(&__active_record, &__shown);
+
+	__record.len = 0;
+	__put(&__record, ticks);
+	__put(&__record, current ? current->__index + 1 : 0);
+	__put(&__record, __nr_process_records);
+	__append(&__record, &__process_records);
+	__append(&__record, &__queue_record);
+	__put(&__record, __nr_resource_records);
+	__append(&__record, &__resource_records);
+	__append(&__record, &__active_record);
+
+	__put(&__buffer, __record.len);
+	__append(&__buffer, &__record);
+
+	if (__buffer.len >= SNAPSHOT_FLUSH_SIZE) __flush();
+}
+
+bool finish_snapshots(void)
+{
+	bool ret;
+
+	if (!__file) return true;
+
+	ret = __flush();
+	if (fclose(__file)) {
+		fprintf(stderr, "Unable to write snapshots: %s\n", strerror(errno));
+		ret = false;
+	}
+	__file = NULL;
+
+	for (int i = 0; i < nr_resources; i++) {
+		free(__resources[i].waiters.index);
+	}
+	free(__resources);
+	free(__processes);
+	free(__shown.index);
+	free(__readyqueue.index);
+	free(__queue.index);
+	free(__process_records.data);
+	free(__resource_records.data);
+	free(__queue_record.data);
+	free(__active_record.data);
+	free(__record.data);
+	free(__buffer.data);
+
+	return ret;
+}
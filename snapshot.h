@@ -0,0 +1,105 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stdint.h>
+
+/**
+ * Compact snapshots of the system state. take_snapshot() records what
+ * dump_status() prints -- the current process, the processes in the ready
+ * queue, and the resources being owned or waited for along with their
+ * waiters -- into a buffer in binary, and the buffer is written into a file
+ * as it fills up. Render the file with snapview.
+ *
+ * A snapshot only records what has changed since the previous one. The
+ * processes are recorded when they show up first or their status, age, or
+ * priority changes, and the resources when their holders or waiters change.
+ * The ready queue and the waitqueues are recorded as the number of
+ * processes dropped from the head and the processes appended to the tail
+ * when they change in that way, which is usually the case. So, a snapshot
+ * is a few bytes when little happens, and snapshots can be taken every tick.
+ * Snapshots are decoded from the beginning of the file for the same reason.
+ *
+ * The file starts with SNAPSHOT_MAGIC and SNAPSHOT_VERSION in uint32_t's,
+ * followed by the snapshots. All the numbers in a snapshot are in the
+ * unsigned LEB128 encoding, and processes are referred to by their indexes
+ * in the process table (+1 to tell none from them where it can be none).
+ * The active resources are listed in the order of @active_resources, which
+ * is the order dump_status() prints them in.
+ *
+ *   snapshot:  length of the rest, tick, current+1,
+ *              # of processes, process..., queue (the ready queue),
+ *              # of resources, resource...,
+ *              queue (the active resources by their indexes)
+ *   process:   index, pid, status, starts_at, age, lifespan, prio
+ *   resource:  index, id, owner+1, # of holders, queue (the waitqueue)
+ *   queue:     0, # of processes, index...  (all processes in the queue)
+ *            | dropped+1, # of appended, index...
+ */
+#define SNAPSHOT_MAGIC		0x50414e53	/* "SNAP" */
+#define SNAPSHOT_VERSION	2
+
+/* Encode @value at @buf, and return the # of bytes taken */
+static inline unsigned int snapshot_put(unsigned char *buf, unsigned int value)
+{
+	unsigned int len = 0;
+
+	while (value >= 0x80) {
+		buf[len++] = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	buf[len++] = value;
+	return len;
+}
+
+/* Decode a value at @*pos before @end and advance @*pos. false if truncated */
+static inline bool snapshot_get(const unsigned char **pos, const unsigned char *end,
+		unsigned int *value)
+{
+	unsigned int shift = 0;
+
+	*value = 0;
+	while (*pos < end && shift < 32) {
+		unsigned char byte = *(*pos)++;
+
+		*value |= (unsigned int)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return true;
+		shift += 7;
+	}
+	return false;
+}
+
+extern unsigned int snapshot_interval;
+
+/**
+ * Write the snapshots into @filename
+ */
+bool init_snapshots(const char *filename);
+
+/**
+ * Take a snapshot of the system. It can be called at any time like
+ * dump_status() once the snapshots are initialized
+ */
+void take_snapshot(void);
+
+/**
+ * Write out the snapshots in the buffer and close the file. This is also done
+ * at exit() if the simulation is aborted
+ */
+bool finish_snapshots(void);
+
+#endif
@@ -0,0 +1,280 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/**
+ * Viewer of the snapshots taken by take_snapshot()
+ *
+ *   Usage: ./snapview [snapshot file] {from tick} {to tick}
+ *
+ * Decode the snapshots from the beginning of the file, and render the ones
+ * taken between @from and @to ticks (all by default) as dump_status() does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "types.h"
+#include "snapshot.h"
+
+static const char * __process_status_sz[] = {
+	"RDY",
+	"RUN",
+	"WAT",
+	"EXT",
+	"THR",
+	"IO ",
+};
+
+struct process {
+	unsigned int pid;
+	unsigned int status;
+	unsigned int starts_at;
+	unsigned int age;
+	unsigned int lifespan;
+	unsigned int prio;
+};
+
+struct queue {
+	unsigned int *index;
+	unsigned int nr;
+	unsigned int size;
+};
+
+struct resource {
+	unsigned int id;
+	unsigned int owner;		/* index + 1 */
+	unsigned int nr_holders;
+	struct queue waiters;
+};
+
+static struct process *processes = NULL;
+static unsigned int nr_processes = 0;
+static struct resource *resources = NULL;
+static unsigned int nr_resources = 0;
+static struct queue readyqueue = {0};
+static struct queue active = {0};		/* Active resources by their indexes */
+
+static void *__grow(void *array, size_t entry_size, unsigned int *nr, unsigned int index)
+{
+	unsigned int size = *nr ? *nr : 64;
+
+	if (index < *nr) return array;
+
+	while (size <= index) size *= 2;
+	array = realloc(array, entry_size * size);
+	memset((char *)array + entry_size * *nr, 0x00, entry_size * (size - *nr));
+	*nr = size;
+	return array;
+}
+
+static void __queue_push(struct queue *q, unsigned int index)
+{
+	if (q->nr == q->size) {
+		q->size = q->size ? q->size * 2 : 16;
+		q->index = realloc(q->index, sizeof(*q->index) * q->size);
+	}
+	q->index[q->nr++] = index;
+}
+
+static bool __decode_queue(const unsigned char **pos, const unsigned char *end,
+		struct queue *q)
+{
+	unsigned int dropped, nr, index;
+
+	if (!snapshot_get(pos, end, &dropped) || !snapshot_get(pos, end, &nr)) return false;
+
+	if (!dropped) {
+		q->nr = 0;
+	} else if (--dropped) {
+		if (dropped > q->nr) return false;
+		memmove(q->index, q->index + dropped, sizeof(*q->index) * (q->nr - dropped));
+		q->nr -= dropped;
+	}
+
+	for (int i = 0; i < nr; i++) {
+		if (!snapshot_get(pos, end, &index)) return false;
+		__queue_push(q, index);
+	}
+	return true;
+}
+
+static bool __decode(const unsigned char *pos, const unsigned char *end,
+		unsigned int *tick, unsigned int *current)
+{
+	unsigned int nr;
+
+	if (!snapshot_get(&pos, end, tick) || !snapshot_get(&pos, end, current)) return false;
+
+	if (!snapshot_get(&pos, end, &nr)) return false;
+	for (int i = 0; i < nr; i++) {
+		unsigned int index;
+		struct process *p;
+
+		if (!snapshot_get(&pos, end, &index)) return false;
+		processes = __grow(processes, sizeof(*processes), &nr_processes, index);
+		p = processes + index;
+
+		if (!snapshot_get(&pos, end, &p->pid) ||
+				!snapshot_get(&pos, end, &p->status) ||
+				!snapshot_get(&pos, end, &p->starts_at) ||
+				!snapshot_get(&pos, end, &p->age) ||
+				!snapshot_get(&pos, end, &p->lifespan) ||
+				!snapshot_get(&pos, end, &p->prio)) {
+			return false;
+		}
+	}
+
+	if (!__decode_queue(&pos, end, &readyqueue)) return false;
+
+	if (!snapshot_get(&pos, end, &nr)) return false;
+	for (int i = 0; i < nr; i++) {
+		unsigned int index;
+		struct resource *r;
+
+		if (!snapshot_get(&pos, end, &index)) return false;
+		resources = __grow(resources, sizeof(*resources), &nr_resources, index);
+		r = resources + index;
+
+		if (!snapshot_get(&pos, end, &r->id) ||
+				!snapshot_get(&pos, end, &r->owner) ||
+				!snapshot_get(&pos, end, &r->nr_holders) ||
+				!__decode_queue(&pos, end, &r->waiters)) {
+			return false;
+		}
+	}
+
+	if (!__decode_queue(&pos, end, &active)) return false;
+	for (int i = 0; i < active.nr; i++) {
+		if (active.index[i] >= nr_resources) return false;
+	}
+
+	return pos == end;
+}
+
+static void __print_process(unsigned int index)
+{
+	struct process *p = processes + index;
+
+	printf("%2d (%s): %d + %d/%d at %d\n",
+			p->pid, p->status < 6 ? __process_status_sz[p->status] : "???",
+			p->starts_at, p->age, p->lifespan, p->prio);
+}
+
+static void __render(unsigned int tick, unsigned int current)
+{
+	printf("***** TICK %d *********\n", tick);
+
+	printf("***** CURRENT *********\n");
+	if (current) __print_process(current - 1);
+
+	printf("***** READY QUEUE *****\n");
+	for (int i = 0; i < readyqueue.nr; i++) {
+		__print_process(readyqueue.index[i]);
+	}
+
+	printf("***** RESOURCES *******\n");
+	for (int i = 0; i < active.nr; i++) {
+		struct resource *r = resources + active.index[i];
+
+		printf("%2d: owned by ", r->id);
+		if (r->owner) {
+			printf("%d\n", processes[r->owner - 1].pid);
+		} else if (r->nr_holders) {
+			printf("%d sharer%s\n", r->nr_holders, r->nr_holders >= 2 ? "s" : "");
+		} else {
+			printf("no one\n");
+		}
+
+		for (int j = 0; j < r->waiters.nr; j++) {
+			printf("    %d is waiting\n", processes[r->waiters.index[j]].pid);
+		}
+	}
+	printf("\n\n");
+}
+
+int main(int argc, char * const argv[])
+{
+	FILE *file;
+	uint32_t header[2];
+	unsigned int from = 0, to = -1;
+	unsigned char *record = NULL;
+	unsigned int size = 0;
+	int ret = EXIT_SUCCESS;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s [snapshot file] {from tick} {to tick}\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (argc > 2) from = atoi(argv[2]);
+	if (argc > 3) to = atoi(argv[3]);
+
+	file = fopen(argv[1], "r");
+	if (!file) {
+		fprintf(stderr, "Unable to open %s: %s\n", argv[1], strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	if (fread(header, sizeof(header), 1, file) != 1 ||
+			header[0] != SNAPSHOT_MAGIC || header[1] != SNAPSHOT_VERSION) {
+		fprintf(stderr, "%s is not a snapshot file\n", argv[1]);
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+
+	while (true) {
+		unsigned char len_bytes[5];
+		const unsigned char *pos = len_bytes;
+		unsigned int len, tick, current;
+		int nr = 0, c;
+
+		/* Read the length of the snapshot byte by byte */
+		while (nr < sizeof(len_bytes) && (c = fgetc(file)) != EOF) {
+			len_bytes[nr++] = c;
+			if (!(c & 0x80)) break;
+		}
+		if (!nr) break;
+
+		if (!snapshot_get(&pos, len_bytes + nr, &len)) goto corrupted;
+		if (len > size) {
+			size = len;
+			record = realloc(record, size);
+		}
+		if (fread(record, 1, len, file) != len) goto corrupted;
+
+		if (!__decode(record, record + len, &tick, &current)) goto corrupted;
+		if (tick > to) break;
+		if (tick >= from) __render(tick, current);
+	}
+	goto out;
+
+corrupted:
+	fprintf(stderr, "%s is truncated or corrupted\n", argv[1]);
+	ret = EXIT_FAILURE;
+
+out:
+	fclose(file);
+	for (int i = 0; i < nr_resources; i++) {
+		free(resources[i].waiters.index);
+	}
+	free(resources);
+	free(processes);
+	free(readyqueue.index);
+	free(active.index);
+	free(record);
+
+	return ret;
+}
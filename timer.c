@@ -0,0 +1,82 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+
+#include "timer.h"
+
+extern unsigned int ticks;
+
+/**
+ * Pending timers sorted by their expiration ticks
+ */
+LIST_HEAD(timers);
+
+void init_timer(struct timer *timer, void (*function)(struct timer *))
+{
+	timer->expires = 0;
+	timer->function = function;
+	INIT_LIST_HEAD(&timer->list);
+}
+
+void add_timer(struct timer *timer, unsigned int expires)
+{
+	struct timer *t;
+
+	assert(!timer_pending(timer));
+
+	timer->expires = expires;
+
+	/**
+	 * Timers are mostly armed for the near future in the simulation. So,
+	 * look for the position from the tail. Timers with the same expiration
+	 * fire in the arming order.
+	 */
+	list_for_each_entry_reverse(t, &timers, list) {
+		if (t->expires <= expires) break;
+	}
+	list_add(&timer->list, &t->list);
+}
+
+void del_timer(struct timer *timer)
+{
+	list_del_init(&timer->list);
+}
+
+bool timer_pending(struct timer *timer)
+{
+	return !list_empty(&timer->list);
+}
+
+bool timers_pending(void)
+{
+	return !list_empty(&timers);
+}
+
+void run_timers(void)
+{
+	while (!list_empty(&timers)) {
+		struct timer *t = list_first_entry(&timers, struct timer, list);
+
+		if (t->expires > ticks) break;
+
+		list_del_init(&t->list);
+		t->function(t);
+	}
+}
@@ -0,0 +1,64 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+/**
+ * One-shot timer. @function is called back with the timer when @ticks reaches
+ * @expires. The timer list is kept sorted by @expires, so expiring timers
+ * are found at the head of the list.
+ */
+struct timer {
+	unsigned int expires;	/* Tick to fire the timer */
+	void (*function)(struct timer *);
+							/* Callback function */
+	struct list_head list;	/* list head for the timer list */
+};
+
+/**
+ * Pending timers in the order they fire. Re-arming timers in this order
+ * keeps the order of the ones expiring at the same tick
+ */
+extern struct list_head timers;
+
+void init_timer(struct timer *timer, void (*function)(struct timer *));
+
+/**
+ * Arm @timer to fire at tick @expires. The timer should not be pending.
+ */
+void add_timer(struct timer *timer, unsigned int expires);
+
+/**
+ * Disarm @timer if it is pending.
+ */
+void del_timer(struct timer *timer);
+
+/**
+ * Return true if @timer is armed and not fired yet
+ */
+bool timer_pending(struct timer *timer);
+
+/**
+ * Return true if any timer is pending in the system
+ */
+bool timers_pending(void);
+
+/**
+ * Fire all timers expiring at the current tick
+ */
+void run_timers(void);
+
+#endif
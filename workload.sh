@@ -0,0 +1,64 @@
+#!/bin/sh
+#
+# Generate a random process description file to stdout
+#
+#   Usage: ./workload.sh [# of processes] [# of resources] [seed]
+#
+# The processes are forked over time with random lifespans and priorities,
+# spread over a few groups, and acquire resources and perform I/O on the way.
+# A process holds at most one resource at a time, so the workload never ends
+# up with a deadlock. It is used to train the profile-guided build (make pgo)
+# and is handy for stressing the schedulers.
+
+NR_PROCESSES=${1:-1000}
+NR_RESOURCES=${2:-32}
+SEED=${3:-1}
+
+awk -v n="$NR_PROCESSES" -v nr="$NR_RESOURCES" -v seed="$SEED" '
+function rand_between(lo, hi) {
+	return lo + int(rand() * (hi - lo + 1))
+}
+
+BEGIN {
+	srand(seed)
+
+	printf("quota batch 3 4\n")
+	printf("weight interactive 2048\n")
+	for (r = 0; r < nr; r++) {
+		kind = rand_between(0, 9)
+		if (kind == 0) {
+			printf("resource %d semaphore %d\n", r, rand_between(2, 4))
+		} else if (kind == 1) {
+			printf("resource %d rwlock\n", r)
+		}
+	}
+	printf("\n")
+
+	for (pid = 0; pid < n; pid++) {
+		lifespan = rand_between(5, 30)
+
+		printf("process %d\n", pid)
+		printf("\tstart %d\n", rand_between(0, n))
+		printf("\tlifespan %d\n", lifespan)
+		printf("\tprio %d\n", rand_between(0, 20))
+
+		group = rand_between(0, 3)
+		if (group == 1) printf("\tgroup interactive\n")
+		if (group == 2) printf("\tgroup batch\n")
+
+		# Critical sections do not overlap within a process
+		at = rand_between(0, 4)
+		while (at < lifespan - 1 && nr > 0) {
+			duration = rand_between(1, 3)
+			if (at + duration > lifespan) duration = lifespan - at
+			mode = rand_between(0, 3) == 0 ? "acquire-shared" : "acquire"
+			printf("\t%s %d %d %d\n", mode, rand_between(0, nr - 1), at, duration)
+			at += duration + rand_between(1, 8)
+		}
+
+		if (rand_between(0, 2) == 0) {
+			printf("\tio %d %d\n", rand_between(1, lifespan - 1), rand_between(1, 10))
+		}
+		printf("end\n\n")
+	}
+}'